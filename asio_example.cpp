@@ -0,0 +1,29 @@
+#include <iostream>
+
+#include "redis_asio.hpp"
+
+int main( int argc, char * argv[] )
+{
+	asio::io_context io;
+
+	auto conn = std::make_shared< redis::asio_connection >( io, argc > 1 ? argv[1] : "127.0.0.1", argc > 2 ? argv[2] : "6379" );
+	conn->on_error( [&conn]( const redis::value & error )
+	{
+		std::cout << "error: " << error.to_string() << std::endl;
+		conn->stop();
+	} );
+	conn->start();
+
+	redis::client & c = conn->get_client();
+
+	c.set( "abc", "123", []( redis::value result ) { std::cout << "set: " << result.to_string() << std::endl; } );
+	c.get( "abc", [&conn]( redis::value result )
+	{
+		std::cout << "get: " << result.to_string() << std::endl;
+		conn->stop();
+	} );
+
+	io.run();
+
+	return 0;
+}
@@ -0,0 +1,280 @@
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "redis_codec.hpp"
+
+static std::atomic<size_t> allocations = 0;
+
+void * operator new( size_t size )
+{
+	++allocations;
+	if ( void * p = std::malloc( size ? size : 1 ) )
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete( void * p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete( void * p, size_t ) noexcept
+{
+	std::free( p );
+}
+
+struct result_t
+{
+	size_t replies = 0;
+	size_t bytes = 0;
+	size_t allocs = 0;
+	double seconds = 0;
+};
+
+static void report( const char * name, const result_t & r )
+{
+	std::printf( "%-28s %12.1f ns/reply %12.1f MB/s %10.2f allocs/reply\n", name,
+				 r.seconds * 1e9 / r.replies,
+				 r.bytes / r.seconds / ( 1024 * 1024 ),
+				 double( r.allocs ) / r.replies );
+}
+
+template< typename Func > static result_t measure( size_t replies_per_run, size_t bytes_per_run, Func && func )
+{
+	result_t r;
+
+	func(); // warm up
+
+	auto beg = std::chrono::steady_clock::now();
+	size_t allocs = allocations;
+
+	do
+	{
+		func();
+		r.replies += replies_per_run;
+		r.bytes += bytes_per_run;
+		r.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - beg ).count();
+	} while ( r.seconds < 0.2 );
+
+	r.allocs = allocations - allocs;
+
+	return r;
+}
+
+// Parses every reply in data, feeding it in chunks of at most chunk bytes
+static size_t parse_all( redis::parser & p, const std::string & data, size_t chunk )
+{
+	size_t replies = 0;
+
+	for ( size_t off = 0; off < data.size(); )
+	{
+		size_t end = std::min( data.size(), off + chunk );
+
+		auto cur = data.begin() + off;
+		while ( cur != data.begin() + end )
+		{
+			auto result = p.parse( cur, data.begin() + end );
+			cur += result.first;
+
+			if ( result.second == redis::parser::Completed )
+				++replies;
+			else if ( result.second == redis::parser::Error )
+				std::abort();
+		}
+
+		off = end;
+	}
+
+	return replies;
+}
+
+static std::string repeat( const std::string & reply, size_t count )
+{
+	std::string data;
+	data.reserve( reply.size() * count );
+	for ( size_t i = 0; i < count; ++i )
+		data.append( reply );
+	return data;
+}
+
+static std::string bulk( size_t size )
+{
+	return "$" + std::to_string( size ) + "\r\n" + std::string( size, 'x' ) + "\r\n";
+}
+
+static void bench_parse( const char * name, const std::string & reply, size_t count )
+{
+	std::string data = repeat( reply, count );
+	redis::parser p;
+
+	report( name, measure( count, data.size(), [&]() { parse_all( p, data, data.size() ); } ) );
+}
+
+// Parses contiguous replies in place, as client::commit() does with its own read buffer
+static void bench_whole( const char * name, const std::string & reply, size_t count )
+{
+	std::string data = repeat( reply, count );
+	redis::parser p;
+
+	report( name, measure( count, data.size(), [&]()
+	{
+		for ( const char * cur = data.data(), * end = cur + data.size(); cur != end; )
+		{
+			auto result = p.parse_whole( cur, end );
+			if ( result.second != redis::parser::Completed )
+				std::abort();
+			cur += result.first;
+		}
+	} ) );
+}
+
+// Feeds one reply split at every byte boundary, as two reads
+static void bench_split( const char * name, const std::string & reply )
+{
+	redis::parser p;
+	size_t total = 0;
+	for ( size_t i = 1; i < reply.size(); ++i )
+		total += reply.size();
+
+	report( name, measure( reply.size() - 1, total, [&]()
+	{
+		for ( size_t i = 1; i < reply.size(); ++i )
+		{
+			size_t replies = 0;
+			auto mid = reply.begin() + i;
+
+			for ( auto cur = reply.begin(); cur != mid; )
+				cur += p.parse( cur, mid ).first;
+			for ( auto cur = mid; cur != reply.end(); )
+			{
+				auto result = p.parse( cur, reply.end() );
+				cur += result.first;
+				replies += result.second == redis::parser::Completed;
+			}
+
+			if ( replies != 1 )
+				std::abort();
+		}
+	} ) );
+}
+
+static void bench_encode( const char * name, const std::vector<std::string_view> & args )
+{
+	std::string out;
+	redis::client::encode( out, args );
+
+	size_t size = out.size();
+
+	report( name, measure( 1000, size * 1000, [&]()
+	{
+		for ( int i = 0; i < 1000; ++i )
+		{
+			out.clear();
+			redis::client::encode( out, args );
+		}
+	} ) );
+}
+
+static void bench_command( const char * name, const std::vector<std::string_view> & args )
+{
+	size_t written = 0;
+	redis::client c( [&]( std::string_view data ) { written += data.size(); } );
+	std::string replies = repeat( "+OK\r\n", 1000 );
+
+	std::string probe;
+	redis::client::encode( probe, args );
+
+	report( name, measure( 1000, probe.size() * 1000, [&]()
+	{
+		for ( int i = 0; i < 1000; ++i )
+			c.command( args, nullptr );
+
+		c.input( replies.begin(), replies.end() );
+	} ) );
+}
+
+// JSON documents with repeated keys and varying numbers, about as compressible as typical payloads
+static std::string document( size_t size )
+{
+	std::string doc = "[";
+	for ( size_t i = 0; doc.size() < size; ++i )
+		doc.append( "{\"id\":" + std::to_string( i * 7919 % 100003 ) + ",\"name\":\"user" + std::to_string( i ) + "\",\"active\":" + ( i % 3 ? "true" : "false" ) + ",\"score\":" + std::to_string( i * 31 % 997 ) + "}," );
+	doc.resize( size );
+	return doc;
+}
+
+// Bytes saved on the wire against the CPU spent encoding and decoding them
+static void bench_codec( size_t size )
+{
+	redis::value_codec codec( { 0 } );
+	std::string value = document( size ), stored, decoded( size, 0 );
+	size_t count = std::max<size_t>( 1, 1024 * 1024 / size );
+
+	auto enc = measure( count, size * count, [&]()
+	{
+		for ( size_t i = 0; i < count; ++i )
+			codec.encode( value, stored );
+	} );
+
+	auto dec = measure( count, size * count, [&]()
+	{
+		for ( size_t i = 0; i < count; ++i )
+		{
+			if ( codec.decode( stored, decoded.data(), decoded.size() ) != value.size() )
+				std::abort();
+		}
+	} );
+
+	if ( decoded != value )
+		std::abort();
+
+	std::printf( "%10zu B %10zu B %7.2fx %12.1f MB/s %12.1f MB/s %10.1f us\n", size, stored.size(), double( size ) / stored.size(),
+				 enc.bytes / enc.seconds / ( 1024 * 1024 ), dec.bytes / dec.seconds / ( 1024 * 1024 ), ( enc.seconds / enc.replies + dec.seconds / dec.replies ) * 1e6 );
+}
+
+int main()
+{
+	std::string nested;
+	for ( int i = 0; i < 64; ++i )
+		nested.append( "*1\r\n" );
+	nested.append( ":1\r\n" );
+
+	std::string array = "*10000\r\n" + repeat( bulk( 8 ), 10000 );
+
+	std::string mixed = "*3\r\n+OK\r\n:42\r\n" + bulk( 32 );
+
+	std::string value( 1024, 'x' );
+
+	std::printf( "parser\n" );
+	bench_parse( "simple string", "+OK\r\n", 10000 );
+	bench_parse( "integer", ":1234567890\r\n", 10000 );
+	bench_parse( "bulk 1KB", bulk( 1024 ), 1000 );
+	bench_parse( "bulk 1MB", bulk( 1024 * 1024 ), 4 );
+	bench_parse( "nested array depth 64", nested, 1000 );
+	bench_parse( "array 10k elements", array, 1 );
+	bench_split( "split at every byte", mixed );
+
+	std::printf( "\nparser, whole replies in place\n" );
+	bench_whole( "simple string", "+OK\r\n", 10000 );
+	bench_whole( "integer", ":1234567890\r\n", 10000 );
+	bench_whole( "bulk 1KB", bulk( 1024 ), 1000 );
+	bench_whole( "bulk 1MB", bulk( 1024 * 1024 ), 4 );
+	bench_whole( "nested array depth 64", nested, 1000 );
+	bench_whole( "array 10k elements", array, 1 );
+
+	std::printf( "\nencoder\n" );
+	bench_encode( "encode GET", { "GET", "user:1000" } );
+	bench_encode( "encode SET 1KB", { "SET", "user:1000", value } );
+	bench_command( "command + reply GET", { "GET", "user:1000" } );
+
+
+	std::printf( "\ncodec, lz over JSON documents\n" );
+	std::printf( "%12s %12s %8s %17s %17s %13s\n", "value", "stored", "ratio", "encode", "decode", "cpu/value" );
+	for ( size_t size : { 256, 1024, 4096, 16384, 65536, 1024 * 1024 } )
+		bench_codec( size );
+
+	return 0;
+}
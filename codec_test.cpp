@@ -0,0 +1,139 @@
+#include <cstdio>
+
+#include "redis_codec.hpp"
+
+static int failures = 0;
+
+#define CHECK( expr ) \
+	do { if ( !( expr ) ) { std::printf( "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #expr ); ++failures; } } while ( 0 )
+
+static std::string document( size_t size )
+{
+	std::string doc;
+	for ( size_t i = 0; doc.size() < size; ++i )
+		doc.append( "{\"id\":" + std::to_string( i * 7919 % 100003 ) + ",\"name\":\"user" + std::to_string( i ) + "\"}," );
+	doc.resize( size );
+	return doc;
+}
+
+static std::string bulk( std::string_view s )
+{
+	return "$" + std::to_string( s.size() ) + "\r\n" + std::string( s ) + "\r\n";
+}
+
+static void round_trip()
+{
+	redis::value_codec codec;
+
+	for ( size_t size : { 0, 1, 1023, 1024, 8192, 65536, 1024 * 1024 } )
+	{
+		std::string value = document( size ), stored, decoded;
+		codec.encode( value, stored );
+
+		CHECK( codec.decoded_size( stored ) == value.size() );
+		CHECK( codec.decode( stored, decoded ) );
+		CHECK( decoded == value );
+	}
+
+	// plain values that start with the header byte are escaped on the way in
+	std::string value = "\xC7\x05hello world", stored, decoded;
+	codec.encode( value, stored );
+	CHECK( stored != value );
+	CHECK( codec.decode( stored, decoded ) && decoded == value );
+}
+
+static void undersized()
+{
+	redis::value_codec codec;
+
+	std::string value = document( 8192 ), stored;
+	codec.encode( value, stored );
+	CHECK( stored.size() < value.size() );
+
+	std::string out( value.size() - 1, 0 );
+	CHECK( codec.decode( stored, out.data(), out.size() ) == std::string_view::npos );
+
+	out.assign( stored.size(), 0 );
+	CHECK( codec.decode( stored, out.data(), out.size() ) == std::string_view::npos );
+
+	out.assign( value.size(), 0 );
+	CHECK( codec.decode( stored, out.data(), out.size() ) == value.size() && out == value );
+}
+
+static void corrupt()
+{
+	redis::value_codec codec;
+
+	std::string value = document( 8192 ), stored, decoded;
+	codec.encode( value, stored );
+
+	std::string truncated = stored.substr( 0, stored.size() / 2 );
+	CHECK( !codec.decode( truncated, decoded ) && decoded.empty() );
+
+	std::string flipped = stored;
+	for ( size_t i = 8; i < flipped.size(); i += 7 )
+		flipped[i] = char( flipped[i] ^ 0x5A );
+	CHECK( !codec.decode( flipped, decoded ) );
+}
+
+static void legacy()
+{
+	redis::value_codec codec;
+
+	// values written without a codec whose first bytes only look like a header
+	for ( std::string value : { std::string( "\xC7\x05hello world" ), std::string( "\xC7\x01\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01x" ), std::string( "\xC7\x01\x80" ), std::string( "plain" ) } )
+	{
+		std::string decoded;
+		CHECK( codec.decoded_size( value ) == value.size() );
+		CHECK( codec.decode( value, decoded ) && decoded == value );
+	}
+}
+
+static void client_get()
+{
+	redis::value_codec codec;
+	std::string value = document( 8192 ), stored;
+	codec.encode( value, stored );
+
+	redis::client client( []( std::string_view ) {} );
+	redis::codec_client c( client );
+
+	std::string reply = bulk( stored ) + bulk( stored.substr( 0, stored.size() / 2 ) );
+
+	std::vector< redis::value > results;
+	c.get( "a", [&]( redis::value result ) { results.push_back( std::move( result ) ); } );
+	c.get( "b", [&]( redis::value result ) { results.push_back( std::move( result ) ); } );
+	client.input( reply.begin(), reply.end() );
+
+	CHECK( results.size() == 2 );
+	CHECK( results.size() > 0 && results[0].is_ok() && results[0].get_string() == value );
+	CHECK( results.size() > 1 && !results[1].is_ok() );
+
+	std::string out;
+	results.clear();
+	c.get( "a", out, [&]( redis::value result ) { results.push_back( std::move( result ) ); } );
+	c.get( "b", out, [&]( redis::value result ) { results.push_back( std::move( result ) ); } );
+	client.input( reply.begin(), reply.end() );
+
+	CHECK( results.size() == 2 );
+	CHECK( results.size() > 0 && results[0].is_ok() && results[0].get_string() == stored );
+	CHECK( results.size() > 1 && !results[1].is_ok() );
+}
+
+int main()
+{
+	round_trip();
+	undersized();
+	corrupt();
+	legacy();
+	client_get();
+
+	if ( failures != 0 )
+	{
+		std::printf( "%d checks failed\n", failures );
+		return 1;
+	}
+
+	std::printf( "all checks passed\n" );
+	return 0;
+}
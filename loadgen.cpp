@@ -0,0 +1,351 @@
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <random>
+#include <cstring>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+
+#include "redis_fake_server.hpp"
+
+#ifdef REDIS_CLIENT_HAVE_URING
+#include "redis_uring.hpp"
+#endif
+
+struct options_t
+{
+	std::string host = "127.0.0.1";
+	uint16_t port = 0;          // 0 starts the in-process fake server
+	bool socketpair = false;    // talk to the fake server over socketpairs instead of TCP
+	std::string command = "get";
+	size_t connections = 4;
+	size_t threads = 2;
+	size_t pipeline = 16;
+	size_t value_size = 64;
+	size_t keys = 10000;
+	double seconds = 5;
+	bool metrics = false;       // print the client metrics of the first connection
+	bool uring = false;         // one io_uring loop per thread instead of poll()
+	bool sqpoll = false;
+};
+
+struct connection_t
+{
+	int fd = -1;
+	size_t pending = 0;
+	size_t sent = 0;
+	std::string out;
+	redis::client client{ [this]( std::string_view data ) { out.append( data ); } };
+};
+
+static int connect_to( const options_t & opts, uint16_t port )
+{
+	int fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons( port );
+	::inet_pton( AF_INET, opts.host.c_str(), &addr.sin_addr );
+
+	if ( ::connect( fd, reinterpret_cast<sockaddr *>( &addr ), sizeof( addr ) ) != 0 )
+	{
+		std::perror( "connect" );
+		std::exit( 1 );
+	}
+
+	int on = 1;
+	::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+
+	return fd;
+}
+
+static void set_nonblocking( int fd )
+{
+	::fcntl( fd, F_SETFL, ::fcntl( fd, F_GETFL ) | O_NONBLOCK );
+}
+
+// Writes what the socket takes without blocking, false on a broken connection
+static bool flush( connection_t & conn )
+{
+	while ( conn.sent < conn.out.size() )
+	{
+		ssize_t n = ::write( conn.fd, conn.out.data() + conn.sent, conn.out.size() - conn.sent );
+		if ( n < 0 )
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		conn.sent += n;
+	}
+
+	conn.out.clear();
+	conn.sent = 0;
+	return true;
+}
+
+// Reads what is available without blocking, false on a broken or closed connection
+static bool drain( connection_t & conn )
+{
+	while ( conn.pending != 0 )
+	{
+		auto buf = conn.client.prepare();
+		ssize_t n = ::read( conn.fd, buf.first, buf.second );
+		if ( n < 0 )
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		if ( n == 0 )
+			return false;
+		conn.client.commit( n );
+	}
+	return true;
+}
+
+static void issue( const options_t & opts, redis::client & client, size_t & pending, std::mt19937_64 & rng, const std::string & value, redis::histogram & hist )
+{
+	std::string key = "key:" + std::to_string( rng() % opts.keys );
+	auto start = std::chrono::steady_clock::now();
+
+	auto callback = [&pending, &hist, start]( redis::value )
+	{
+		hist.record( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count() );
+		--pending;
+	};
+
+	std::string_view cmd = opts.command;
+	if ( cmd == "mixed" )
+		cmd = ( rng() % 10 ) < 8 ? "get" : "set";
+
+	if ( cmd == "get" )
+		client.get( key, callback );
+	else if ( cmd == "set" )
+		client.set( key, value, callback );
+	else if ( cmd == "hset" )
+		client.hset( "hash", key, value, callback );
+	else if ( cmd == "sadd" )
+		client.sadd( "set", { key }, callback );
+	else if ( cmd == "publish" )
+		client.publish( "channel", value, callback );
+	else
+		client.ping( callback );
+
+	++pending;
+}
+
+// Every connection of the thread gets a full pipeline issued, then one poll() loop writes the pipelines and
+// reads the replies together, so large replies never leave both ends blocked on full socket buffers
+static void worker( const options_t & opts, std::vector< connection_t * > conns, redis::histogram & hist, std::chrono::steady_clock::time_point deadline, uint64_t seed )
+{
+	std::mt19937_64 rng( seed );
+	std::string value( opts.value_size, 'x' );
+	std::vector< pollfd > fds( conns.size() );
+
+	while ( std::chrono::steady_clock::now() < deadline )
+	{
+		for ( auto conn : conns )
+		{
+			for ( size_t i = 0; i < opts.pipeline; ++i )
+				issue( opts, conn->client, conn->pending, rng, value, hist );
+		}
+
+		for ( ;; )
+		{
+			bool busy = false;
+			for ( size_t i = 0; i < conns.size(); ++i )
+			{
+				fds[i].events = ( conns[i]->pending != 0 ? POLLIN : 0 ) | ( conns[i]->sent < conns[i]->out.size() ? POLLOUT : 0 );
+				fds[i].fd = fds[i].events != 0 ? conns[i]->fd : -1;    // poll() skips idle connections
+				fds[i].revents = 0;
+				busy |= fds[i].events != 0;
+			}
+
+			if ( !busy )
+				break;
+
+			if ( ::poll( fds.data(), fds.size(), -1 ) < 0 && errno != EINTR )
+				return;
+
+			for ( size_t i = 0; i < conns.size(); ++i )
+			{
+				if ( fds[i].revents == 0 )
+					continue;
+
+				if ( ( fds[i].revents & POLLNVAL ) || !flush( *conns[i] ) || !drain( *conns[i] ) )
+					return;
+			}
+		}
+	}
+}
+
+#ifdef REDIS_CLIENT_HAVE_URING
+// All connections of the thread share one ring; each round is submitted with a single io_uring_enter
+static void worker_uring( const options_t & opts, size_t count, uint16_t port, redis::fake_server * server, redis::histogram & hist, std::chrono::steady_clock::time_point deadline, uint64_t seed )
+{
+	redis::uring_options uo;
+	uo.max_connections = count;
+	uo.sqpoll = opts.sqpoll;
+
+	redis::uring_loop loop( uo );
+
+	std::vector< redis::client * > clients;
+	for ( size_t i = 0; i < count; ++i )
+	{
+		if ( opts.socketpair && server )
+		{
+			int fds[2];
+			::socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+			server->serve( fds[1] );
+			clients.push_back( &loop.add( fds[0] ) );
+		}
+		else
+		{
+			clients.push_back( &loop.connect( opts.host, std::to_string( port ) ) );
+		}
+	}
+
+	std::mt19937_64 rng( seed );
+	std::string value( opts.value_size, 'x' );
+	size_t pending = 0;
+
+	while ( std::chrono::steady_clock::now() < deadline )
+	{
+		for ( auto client : clients )
+		{
+			for ( size_t i = 0; i < opts.pipeline; ++i )
+				issue( opts, *client, pending, rng, value, hist );
+		}
+
+		while ( pending != 0 )
+			loop.run_once();
+	}
+}
+#endif
+
+static void usage()
+{
+	std::printf( "redis_client_loadgen [options]\n"
+				 "  --host <ip>          server address (127.0.0.1)\n"
+				 "  --port <port>        server port, 0 starts the in-process fake server (0)\n"
+				 "  --socketpair         use socketpairs to the in-process fake server\n"
+				 "  --command <name>     get, set, hset, sadd, ping, publish or mixed (get)\n"
+				 "  --connections <n>    connections (4)\n"
+				 "  --threads <n>        threads (2)\n"
+				 "  --pipeline <n>       commands in flight per connection (16)\n"
+				 "  --value-size <n>     value size in bytes (64)\n"
+				 "  --keys <n>           key space (10000)\n"
+				 "  --seconds <n>        duration (5)\n"
+				 "  --metrics            print client metrics (REDIS_CLIENT_INSTRUMENTATION builds)\n"
+				 "  --uring              drive the connections with io_uring, one ring per thread (Linux)\n"
+				 "  --sqpoll             use a kernel submission queue polling thread with --uring\n" );
+}
+
+int main( int argc, char ** argv )
+{
+	options_t opts;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		std::string_view arg = argv[i];
+		const char * next = i + 1 < argc ? argv[i + 1] : "";
+
+		if ( arg == "--socketpair" ) { opts.socketpair = true; continue; }
+		else if ( arg == "--metrics" ) { opts.metrics = true; continue; }
+		else if ( arg == "--uring" ) { opts.uring = true; continue; }
+		else if ( arg == "--sqpoll" ) { opts.sqpoll = true; continue; }
+		else if ( arg == "--host" ) opts.host = next;
+		else if ( arg == "--port" ) opts.port = uint16_t( std::atoi( next ) );
+		else if ( arg == "--command" ) opts.command = next;
+		else if ( arg == "--connections" ) opts.connections = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--threads" ) opts.threads = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--pipeline" ) opts.pipeline = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--value-size" ) opts.value_size = std::atoi( next );
+		else if ( arg == "--keys" ) opts.keys = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--seconds" ) opts.seconds = std::atof( next );
+		else { usage(); return arg == "--help" ? 0 : 1; }
+		++i;
+	}
+
+	std::unique_ptr< redis::fake_server > server;
+	uint16_t port = opts.port;
+	if ( port == 0 )
+	{
+		server = std::make_unique< redis::fake_server >();
+		port = server->port();
+	}
+
+#ifndef REDIS_CLIENT_HAVE_URING
+	if ( opts.uring )
+	{
+		std::printf( "io_uring is not available in this build\n" );
+		return 1;
+	}
+#endif
+
+	opts.threads = std::min( opts.threads, opts.connections );
+
+	std::vector< std::unique_ptr< connection_t > > conns;
+	for ( size_t i = 0; i < opts.connections && !opts.uring; ++i )
+	{
+		auto conn = std::make_unique< connection_t >();
+
+		if ( opts.socketpair && server )
+		{
+			int fds[2];
+			::socketpair( AF_UNIX, SOCK_STREAM, 0, fds );
+			server->serve( fds[1] );
+			conn->fd = fds[0];
+		}
+		else
+		{
+			conn->fd = connect_to( opts, port );
+		}
+
+		set_nonblocking( conn->fd );
+		conns.push_back( std::move( conn ) );
+	}
+
+	std::vector< redis::histogram > hists( opts.threads );
+	std::vector< std::thread > threads;
+
+	auto beg = std::chrono::steady_clock::now();
+	auto deadline = beg + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( opts.seconds ) );
+
+	for ( size_t t = 0; t < opts.threads; ++t )
+	{
+#ifdef REDIS_CLIENT_HAVE_URING
+		if ( opts.uring )
+		{
+			size_t count = opts.connections / opts.threads + ( t < opts.connections % opts.threads );
+			threads.emplace_back( worker_uring, std::cref( opts ), count, port, server.get(), std::ref( hists[t] ), deadline, 0x9E3779B97F4A7C15ull * ( t + 1 ) );
+			continue;
+		}
+#endif
+
+		std::vector< connection_t * > mine;
+		for ( size_t i = t; i < conns.size(); i += opts.threads )
+			mine.push_back( conns[i].get() );
+
+		threads.emplace_back( worker, std::cref( opts ), std::move( mine ), std::ref( hists[t] ), deadline, 0x9E3779B97F4A7C15ull * ( t + 1 ) );
+	}
+
+	for ( auto & it : threads )
+		it.join();
+
+	double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - beg ).count();
+
+	redis::histogram all;
+	for ( const auto & it : hists )
+		all.merge( it );
+
+	std::printf( "%s: %zu connections, %zu threads, pipeline %zu, value %zu bytes%s\n", opts.command.c_str(), opts.connections, opts.threads, opts.pipeline, opts.value_size, opts.uring ? ", io_uring" : "" );
+	std::printf( "requests %llu in %.2f s, %.0f ops/s\n", (unsigned long long)all.total(), elapsed, all.total() / elapsed );
+	std::printf( "latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+				 all.percentile( 50 ) / 1e3, all.percentile( 90 ) / 1e3, all.percentile( 99 ) / 1e3, all.percentile( 99.9 ) / 1e3, all.max() / 1e3 );
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+	if ( opts.metrics && !conns.empty() )
+		std::printf( "\n%s", conns[0]->client.snapshot().prometheus().c_str() );
+#endif
+
+	for ( auto & it : conns )
+		::close( it->fd );
+
+	return 0;
+}
@@ -0,0 +1,292 @@
+/*!
+ * \file	redis_asio.hpp
+ *
+ * \author	redis_client contributors
+ * \date	2026/10/18
+ *
+ * Optional asio transport for redis::client: a persistent read loop, coalesced writes and reconnect.
+ */
+#ifndef REDIS_ASIO_HPP__8C4F1A27_5D3E_4B9A_A6E1_0F72C39D4B18
+#define REDIS_ASIO_HPP__8C4F1A27_5D3E_4B9A_A6E1_0F72C39D4B18
+
+#include <asio.hpp>
+
+#include "redis_client.hpp"
+
+namespace redis
+{
+	struct asio_options
+	{
+		std::string password;       // AUTH after every (re)connect when not empty
+		int db = 0;                 // SELECT after every (re)connect when not zero
+		std::chrono::milliseconds reconnect_delay = std::chrono::milliseconds( 1000 );
+		size_t read_buffer = 16 * 1024;  // used until the AUTH/SELECT replies are in, then the client's own buffer takes over
+	};
+
+	class asio_connection : public std::enable_shared_from_this< asio_connection >
+	{
+	public:
+		using error_callback_t = std::function< void( const redis::value & ) >;
+
+	public:
+		// Create with std::make_shared, then call start()
+		asio_connection( asio::io_context & io, std::string_view host, std::string_view port, asio_options options = {} )
+			: _strand( asio::make_strand( io ) ), _socket( _strand ), _resolver( _strand ), _timer( _strand )
+			, _host( host ), _port( port ), _options( std::move( options ) ), _rbuf( _options.read_buffer )
+			, _client( [this]( std::string_view data ) { output( data ); } )
+		{
+		}
+
+	public:
+		// Commands may be issued from any thread and before the connection is up; they are sent once it is
+		redis::client & get_client()
+		{
+			return _client;
+		}
+
+		void on_error( error_callback_t callback )
+		{
+			_error = std::move( callback );
+		}
+
+		void start()
+		{
+			asio::post( _strand, [self = shared_from_this()]() { self->connect(); } );
+		}
+
+		void stop()
+		{
+			asio::post( _strand, [self = shared_from_this()]()
+			{
+				self->_stopped = true;
+				self->_timer.cancel();
+				self->disconnect();
+			} );
+		}
+
+	private:
+		void connect()
+		{
+			if ( _stopped )
+				return;
+
+			_resolver.async_resolve( _host, _port, [self = shared_from_this()]( const asio::error_code & ec, asio::ip::tcp::resolver::results_type results )
+			{
+				if ( ec )
+					return self->retry( ec );
+
+				asio::async_connect( self->_socket, results, [self]( const asio::error_code & ec, const asio::ip::tcp::endpoint & )
+				{
+					if ( ec )
+						return self->retry( ec );
+
+					self->connected();
+				} );
+			} );
+		}
+
+		void connected()
+		{
+			_socket.set_option( asio::ip::tcp::no_delay( true ) );
+
+			// AUTH and SELECT replies are consumed here so they never reach the client's callback queue
+			std::string handshake;
+			_handshake = 0;
+			_hparser = redis::parser();
+
+			if ( !_options.password.empty() )
+			{
+				client::encode( handshake, { "AUTH", _options.password } );
+				++_handshake;
+			}
+			if ( _options.db != 0 )
+			{
+				std::string db = std::to_string( _options.db );
+				client::encode( handshake, { "SELECT", db } );
+				++_handshake;
+			}
+
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				_pending.insert( 0, handshake );
+				_connected = true;
+			}
+
+			read();
+			write();
+		}
+
+		void read()
+		{
+			// once the handshake is answered, replies are read straight into the client's own buffer
+			if ( _handshake == 0 )
+			{
+				auto buf = _client.prepare();
+
+				_socket.async_read_some( asio::buffer( buf.first, buf.second ), [self = shared_from_this()]( const asio::error_code & ec, size_t size )
+				{
+					if ( ec )
+						return self->fail( ec );
+
+					self->_client.commit( size );
+					self->read();
+				} );
+
+				return;
+			}
+
+			_socket.async_read_some( asio::buffer( _rbuf ), [self = shared_from_this()]( const asio::error_code & ec, size_t size )
+			{
+				if ( ec )
+					return self->fail( ec );
+
+				const char * beg = self->_rbuf.data(), * end = beg + size;
+
+				while ( self->_handshake != 0 && beg != end )
+				{
+					auto result = self->_hparser.parse( beg, end );
+					beg += result.first;
+
+					if ( result.second == redis::parser::Error )
+						return self->fail( asio::error::make_error_code( asio::error::invalid_argument ) );
+
+					if ( result.second == redis::parser::Completed )
+					{
+						--self->_handshake;
+
+						if ( self->_hparser.result().is_error() && self->_error )
+							self->_error( self->_hparser.result() );
+					}
+				}
+
+				while ( beg != end )
+				{
+					auto buf = self->_client.prepare();
+					size_t count = std::min<size_t>( buf.second, end - beg );
+
+					std::memcpy( buf.first, beg, count );
+					self->_client.commit( count );
+					beg += count;
+				}
+
+				self->read();
+			} );
+		}
+
+		// Called by the client under its write lock; bytes queued while a write is in flight go out together in the next one
+		void output( std::string_view data )
+		{
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				_pending.append( data.data(), data.size() );
+
+				if ( _write_posted || _write_active || !_connected )
+					return;
+
+				_write_posted = true;
+			}
+
+			asio::post( _strand, [self = shared_from_this()]() { self->write(); } );
+		}
+
+		void write()
+		{
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				_write_posted = false;
+
+				if ( _write_active || !_connected || _pending.empty() )
+					return;
+
+				_writing.swap( _pending );
+				_write_active = true;
+			}
+
+			asio::async_write( _socket, asio::buffer( _writing ), asio::bind_executor( _strand, [self = shared_from_this()]( const asio::error_code & ec, size_t )
+			{
+				{
+					std::unique_lock< std::mutex > lock( self->_mutex );
+					self->_write_active = false;
+					self->_writing.clear();
+				}
+
+				if ( ec )
+					return self->fail( ec );
+
+				self->write();
+			} ) );
+		}
+
+		void fail( const asio::error_code & ec )
+		{
+			if ( !_socket.is_open() )
+				return;
+
+			disconnect();
+
+			if ( _error && ec != asio::error::operation_aborted )
+				_error( redis::value( redis::value::io_error, ec.message() ) );
+
+			retry( {} );
+		}
+
+		void disconnect()
+		{
+			asio::error_code ignored;
+			_socket.close( ignored );
+
+			// in-flight callbacks fail together with the bytes that will never be answered
+			_client.reset( [this]()
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				_pending.clear();
+				_connected = false;
+			} );
+		}
+
+		void retry( const asio::error_code & ec )
+		{
+			if ( _stopped )
+				return;
+
+			if ( ec && _error )
+				_error( redis::value( redis::value::io_error, ec.message() ) );
+
+			_timer.expires_after( _options.reconnect_delay );
+			_timer.async_wait( [self = shared_from_this()]( const asio::error_code & ec )
+			{
+				if ( !ec )
+					self->connect();
+			} );
+		}
+
+	private:
+		asio::strand< asio::io_context::executor_type > _strand;
+		asio::ip::tcp::socket _socket;
+		asio::ip::tcp::resolver _resolver;
+		asio::steady_timer _timer;
+
+		std::string _host;
+		std::string _port;
+		asio_options _options;
+		error_callback_t _error;
+
+		std::vector< char > _rbuf;
+		size_t _handshake = 0;
+		redis::parser _hparser;
+		bool _stopped = false;
+
+		std::mutex _mutex;
+		std::string _pending;
+		std::string _writing;
+		bool _connected = false;
+		bool _write_posted = false;
+		bool _write_active = false;
+
+		redis::client _client;
+	};
+}
+
+#endif//REDIS_ASIO_HPP__8C4F1A27_5D3E_4B9A_A6E1_0F72C39D4B18
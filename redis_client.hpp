@@ -10,12 +10,32 @@
 #define REDIS_CLIENT_HPP__94D2E943_814E_4967_A639_26765ED2C208
 
 #include <map>
+#include <array>
+#include <atomic>
+#include <deque>
 #include <mutex>
 #include <stack>
+#include <tuple>
+#include <memory>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <chrono>
 #include <variant>
+#include <optional>
+#include <type_traits>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <thread>
 #include <functional>
+#include <condition_variable>
+#include <string_view>
+
+#if defined( __linux__ )
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 namespace redis
 {
@@ -28,6 +48,7 @@ namespace redis
 
 	class value
 	{
+	public:
 		enum ErrorCode
 		{
 			no_error,
@@ -35,6 +56,7 @@ namespace redis
 			timeout,
 			redis_parse_error,  //redis protocal parse error
 			redis_reject_error, //rejected by redis server
+			overload_error,     //rejected by client flow control
 			unknown_error
 		};
 
@@ -44,7 +66,7 @@ namespace redis
 		{
 		}
 
-		value( value && other )
+		value( value && other ) noexcept
 			: _value( std::move( other._value ) ), _error_code( other._error_code )
 		{
 		}
@@ -64,11 +86,21 @@ namespace redis
 		{
 		}
 
+		value( std::string && s )
+			: _value( std::move( s ) )
+		{
+		}
+
 		value( const std::vector<redis::value> & a )
 			: _value( a )
 		{
 		}
 
+		value( std::vector<redis::value> && a )
+			: _value( std::move( a ) )
+		{
+		}
+
 		value( int error_code, const std::string & error_msg )
 			: _value( error_msg ), _error_code( error_code )
 		{
@@ -238,11 +270,124 @@ namespace redis
 			return _value;
 		}
 
+		// Moves the completed reply out instead of copying it
+		redis::value take()
+		{
+			return std::move( _value );
+		}
+
 		template< typename Iterator > std::pair<size_t, result_t> parse( Iterator beg, Iterator end )
 		{
 			return chunk( beg, end );
 		}
 
+		// Parses one whole reply straight from contiguous memory, so no partial token is ever staged. Nothing is
+		// consumed while the reply is incomplete: call again with the same bytes, from the start of the reply,
+		// once more have arrived. Finished elements are kept, so parsing resumes at the unfinished one, and
+		// needed() tells how many bytes to wait for when that is known.
+		// Do not mix with parse() on a reply that parse() has already started.
+		std::pair<size_t, result_t> parse_whole( const char * beg, const char * end )
+		{
+			const char * cur = beg + _whole_offset;
+			_needed = 0;
+
+			while ( true )
+			{
+				// everything before cur belongs to finished elements or array headers
+				_whole_offset = cur - beg;
+
+				if ( cur == end )
+					return std::make_pair( 0, Incompleted );
+
+				char type = *cur;
+				const char * line = cur + 1;
+				const char * cr = static_cast<const char *>( std::memchr( line, '\r', end - line ) );
+
+				if ( cr == nullptr || cr + 1 == end )
+					return std::make_pair( 0, Incompleted );
+				if ( cr[1] != '\n' )
+					return whole_error( beg, end );
+
+				cur = cr + 2;
+
+				redis::value value;
+				int64_t size = 0;
+
+				switch ( type )
+				{
+				case string_match:
+				case error_match:
+					for ( const char * it = line; it != cr; ++it )
+					{
+						if ( !is_char( *it ) || is_control( *it ) )
+							return whole_error( beg, end );
+					}
+					value = type == string_match ? redis::value( std::string( line, cr ) ) : redis::value( redis::value::redis_reject_error, std::string( line, cr ) );
+					break;
+				case integer_match:
+					if ( !to_int64( line, cr, size ) )
+						return whole_error( beg, end );
+					value = redis::value( size );
+					break;
+				case bulk_match:
+					if ( !to_int64( line, cr, size ) || size < -1 )
+						return whole_error( beg, end );
+					if ( size >= 0 )
+					{
+						if ( end - cur < size + 2 )
+						{
+							_needed = ( cur - beg ) + size + 2;
+							return std::make_pair( 0, Incompleted );
+						}
+						if ( cur[size] != '\r' || cur[size + 1] != '\n' )
+							return whole_error( beg, end );
+
+						value = redis::value( std::string( cur, cur + size ) );
+						cur += size + 2;
+					}
+					break;
+				case array_match:
+					if ( !to_int64( line, cr, size ) || size < -1 )
+						return whole_error( beg, end );
+					if ( size > 0 )
+					{
+						// every element takes at least 4 bytes, so a bogus size cannot reserve more than the input
+						_frames.emplace_back( std::vector<redis::value>(), size );
+						_frames.back().first.reserve( std::min<size_t>( size, ( end - cur ) / 4 + 1 ) );
+						continue;
+					}
+					if ( size == 0 )
+						value = redis::value( std::vector<redis::value>() );
+					break;
+				default:
+					return whole_error( beg, end );
+				}
+
+				while ( true )
+				{
+					if ( _frames.empty() )
+					{
+						_value = std::move( value );
+						_whole_offset = 0;
+						return std::make_pair( std::distance( beg, cur ), Completed );
+					}
+
+					_frames.back().first.push_back( std::move( value ) );
+					if ( --_frames.back().second != 0 )
+						break;
+
+					value = redis::value( std::move( _frames.back().first ) );
+					_frames.pop_back();
+				}
+			}
+		}
+
+		// Bytes the incomplete reply of the last parse_whole() needs at least, 0 when unknown
+		size_t needed() const
+		{
+			return _needed;
+		}
+
 	protected:
 		template< typename Iterator > std::pair<size_t, result_t> chunk( Iterator beg, Iterator end )
 		{
@@ -355,7 +500,7 @@ namespace redis
 					if ( c == '\n' )
 					{
 						state = Start;
-						_value = redis::value( _buf );
+						_value = redis::value( redis::value::redis_reject_error, _buf );
 					}
 					else
 					{
@@ -560,7 +705,7 @@ namespace redis
 				{
 					if ( !_array_sizes.empty() )
 					{
-						_array_values.top().get_array().push_back( _value );
+						_array_values.top().get_array().push_back( std::move( _value ) );
 
 						while ( !_array_sizes.empty() && --_array_sizes.top() == 0 )
 						{
@@ -569,7 +714,7 @@ namespace redis
 							_array_values.pop();
 
 							if ( !_array_sizes.empty() )
-								_array_values.top().get_array().push_back( _value );
+								_array_values.top().get_array().push_back( std::move( _value ) );
 						}
 					}
 
@@ -634,298 +779,2349 @@ namespace redis
 			return sign ? -value : value;
 		}
 
+		std::pair<size_t, result_t> whole_error( const char * beg, const char * end )
+		{
+			_frames.clear();
+			_whole_offset = 0;
+			return std::make_pair( std::distance( beg, end ), Error );
+		}
+
+		static bool to_int64( const char * beg, const char * end, int64_t & value )
+		{
+			auto result = std::from_chars( beg, end, value );
+			return beg != end && result.ec == std::errc() && result.ptr == end;
+		}
+
 	private:
 		std::string _buf;
 		size_t _bulk_size;
+		size_t _needed = 0;
+		size_t _whole_offset = 0;
+		std::vector< std::pair< std::vector<redis::value>, int64_t > > _frames;
 		redis::value _value;
 		std::stack<state_t> _states;
 		std::stack<int64_t> _array_sizes;
 		std::stack<redis::value> _array_values;
 	};
 
-	class client
+	// Read buffer a transport reads into directly. On Linux the storage is a ring whose pages are mapped twice
+	// back to back, so both the readable bytes and the free space are always contiguous, even across the
+	// wraparound. Elsewhere, or when the mapping fails, it falls back to a flat buffer that is compacted.
+	class read_buffer
 	{
 	public:
-		using result_callback_t = std::function< void( redis::value ) >;
-		using output_callback_t = std::function< void( std::string_view ) >;
-
-	public:
-		client( output_callback_t out_cb )
-			:_output( out_cb )
-		{ }
-
-		~client() = default;
-
-	public:
-		template< typename Iterator > Iterator input( Iterator beg, Iterator end )
+		read_buffer( size_t capacity = 64 * 1024, bool mirrored = true )
+			: _want( std::max<size_t>( capacity, 4096 ) ), _mirrored( mirrored )
 		{
-			std::unique_lock< std::mutex > lock( _rmutex );
-
-			Iterator cur = beg;
+		}
 
-			while ( cur != end )
-			{
-				auto result = _parser.parse( cur, end );
+		read_buffer( const read_buffer & ) = delete;
 
-				if ( result.second == parser::Completed )
-				{
-					consume_message( _parser.result() );
-					std::advance( cur, result.first );
-				}
-				else if ( result.second == parser::Incompleted )
-				{
-					std::advance( cur, result.first );
-					break;
-				}
-				else
-				{
-					consume_message( redis::value( 0, "redis parse error" ) );
-					
-					return end;
-				}
-			}
+		read_buffer & operator=( const read_buffer & ) = delete;
 
-			return cur;
+		~read_buffer()
+		{
+			release();
 		}
 
 	public:
-		void command( const std::vector< std::string_view > & args, result_callback_t callback, std::string_view subscribe_key = {} )
+		// Free space to read into, never empty; grows the buffer when it is full
+		std::pair< char *, size_t > prepare()
 		{
-			std::string cmd;
-
-			cmd.append( "*" ).append( std::to_string( args.size() ) ).append( CRCF );
+			if ( _data == nullptr )
+				allocate( _want );
+			else if ( _size == _capacity )
+				allocate( _capacity * 2 );
 
-			for ( const auto & item : args )
+			if ( !_ring && _head + _size == _capacity )
 			{
-				cmd.append( "$" ).append( std::to_string( item.size() ) ).append( CRCF );
-				cmd.append( item ).append( CRCF );
+				std::memmove( _data, _data + _head, _size );
+				_head = 0;
 			}
 
-			if( _output != nullptr )
-			{
-				std::unique_lock< std::mutex >lock( _wmutex );
-
-				if ( subscribe_key.empty() )
-				{
-					_handler.emplace_back( std::move( callback ) );
-				}
-				else
-				{
-					_subscribe_handler.insert( { std::string( subscribe_key.begin(), subscribe_key.end() ), std::move( callback ) } );
-				}
-
-				_output( cmd );
-			}
+			size_t tail = _head + _size;
+			if ( _ring )
+				return std::make_pair( _data + ( tail % _capacity ), _capacity - _size );
+			return std::make_pair( _data + tail, _capacity - tail );
 		}
 
-	public:
-		void ping( result_callback_t callback )
+		void commit( size_t size )
 		{
-			command( { "PING" }, std::move( callback ) );
+			_size += size;
 		}
 
-		void echo( std::string_view message, result_callback_t callback )
+		std::string_view data() const
 		{
-			command( { "ECHO", message }, std::move( callback ) );
+			return std::string_view( _data + _head, _size );
 		}
 
-		void auth( std::string_view password, result_callback_t callback )
+		void consume( size_t size )
 		{
-			command( { "AUTH", password }, std::move( callback ) );
+			_size -= size;
+			_head = _size == 0 ? 0 : ( _ring ? ( _head + size ) % _capacity : _head + size );
 		}
 
-		void select( int index, result_callback_t callback )
+		// Makes room for at least size readable bytes, e.g. a large bulk reply
+		void reserve( size_t size )
 		{
-			command( { "SELECT", std::to_string( index ) }, std::move( callback ) );
+			if ( size > _capacity )
+				allocate( size );
 		}
 
-		void quit( result_callback_t callback )
+		void clear()
 		{
-			command( { "QUIT" }, std::move( callback ) );
+			_head = 0;
+			_size = 0;
 		}
 
-	public:
-		void set( std::string_view key, std::string_view value, result_callback_t callback )
+		size_t capacity() const
 		{
-			command( { "SET", key, value }, std::move( callback ) );
+			return _capacity;
 		}
 
-		void get( std::string_view key, result_callback_t callback )
+		bool mirrored() const
 		{
-			command( { "GET", key }, std::move( callback ) );
+			return _ring;
 		}
 
-		void del( std::string_view key, result_callback_t callback )
+	private:
+		void allocate( size_t capacity )
 		{
-			command( { "DEL", key }, std::move( callback ) );
-		}
+			size_t size = _want;
+			while ( size < capacity )
+				size *= 2;
 
-	public:
-		void hset( std::string_view key, std::string_view field, std::string_view value, result_callback_t callback )
-		{
-			command( { "HSET", key, field, value }, std::move( callback ) );
-		}
+			char * data = nullptr;
+			bool ring = false;
 
-		void hget( std::string_view key, std::string_view field, result_callback_t callback )
-		{
-			command( { "HGET", key, field }, std::move( callback ) );
-		}
+#if defined( __linux__ )
+			if ( _mirrored )
+			{
+				size_t page = ::sysconf( _SC_PAGESIZE );
+				size = ( size + page - 1 ) / page * page;
 
-		void hdel( std::string_view key, std::string_view field, result_callback_t callback )
-		{
-			command( { "HDEL", key, field }, std::move( callback ) );
-		}
+				data = map_ring( size );
+				ring = data != nullptr;
+			}
+#endif
+			if ( data == nullptr )
+				data = new char[size];
 
-	public:
-		void sadd( std::string_view key, const std::vector<std::string_view> & members, result_callback_t callback )
-		{
-			std::vector<std::string_view> args{ "SADD", key };
-			args.insert( args.end(), members.begin(), members.end() );
-			command( args, std::move( callback ) );
-		}
+			// the readable bytes land at the front of the new storage
+			std::string_view old = this->data();
+			if ( !old.empty() )
+				std::memcpy( data, old.data(), old.size() );
 
-		void scard( std::string_view key, result_callback_t callback )
-		{
-			command( { "SCARD", key }, std::move( callback ) );
-		}
+			release();
 
-		void sdiff( std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
-		{
-			std::vector<std::string_view> args{ "SDIFF", key };
-			args.insert( args.end(), keys.begin(), keys.end() );
-			command( args, std::move( callback ) );
+			_data = data;
+			_capacity = size;
+			_ring = ring;
+			_head = 0;
 		}
 
-		void sdiffstore( std::string_view destination, std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		void release()
 		{
-			std::vector<std::string_view> args{ "SDIFFSTORE", destination, key };
-			args.insert( args.end(), keys.begin(), keys.end() );
-			command( args, std::move( callback ) );
-		}
+			if ( _data == nullptr )
+				return;
 
-		void sinter( std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
-		{
-			std::vector<std::string_view> args{ "SINTER", key };
-			args.insert( args.end(), keys.begin(), keys.end() );
-			command( args, std::move( callback ) );
-		}
+#if defined( __linux__ )
+			if ( _ring )
+				::munmap( _data, _capacity * 2 );
+			else
+#endif
+				delete[] _data;
 
-		void sinterstore( std::string_view destination, std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
-		{
-			std::vector<std::string_view> args{ "SINTERSTORE", destination, key };
-			args.insert( args.end(), keys.begin(), keys.end() );
-			command( args, std::move( callback ) );
+			_data = nullptr;
 		}
 
-		void sismember( std::string_view key, std::string_view member, result_callback_t callback )
+#if defined( __linux__ )
+		static char * map_ring( size_t size )
 		{
-			command( { "SISMEMBER", key, member }, std::move( callback ) );
-		}
+			int fd = ::memfd_create( "redis_client", MFD_CLOEXEC );
+			if ( fd < 0 )
+				return nullptr;
 
-		void smembers( std::string_view key, result_callback_t callback )
-		{
-			command( { "SMEMBERS", key }, std::move( callback ) );
-		}
+			char * base = nullptr;
 
-		void smove( std::string_view source, std::string_view destination, std::string_view member, result_callback_t callback )
-		{
-			command( { "SMOVE", source, destination, member }, std::move( callback ) );
-		}
+			if ( ::ftruncate( fd, size ) == 0 )
+			{
+				void * area = ::mmap( nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
 
-		void spop( std::string_view key, result_callback_t callback )
-		{
-			command( { "SPOP", key }, std::move( callback ) );
-		}
+				if ( area != MAP_FAILED )
+				{
+					base = static_cast<char *>( area );
 
-		void srandmember( std::string_view key, result_callback_t callback )
-		{
-			command( { "SRANDMEMBER", key }, std::move( callback ) );
-		}
+					if ( ::mmap( base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 ) == MAP_FAILED ||
+						 ::mmap( base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 ) == MAP_FAILED )
+					{
+						::munmap( base, size * 2 );
+						base = nullptr;
+					}
+				}
+			}
 
-		void srandmember( std::string_view key, int count, result_callback_t callback )
-		{
-			command( { "SRANDMEMBER", key, std::to_string( count ) }, std::move( callback ) );
+			::close( fd );
+			return base;
 		}
+#endif
 
-		void srem( std::string_view key, std::string_view member, const std::vector<std::string_view> & members, result_callback_t callback )
-		{
-			std::vector<std::string_view> args{ "SREM", key, member };
-			args.insert( args.end(), members.begin(), members.end() );
-			command( args, std::move( callback ) );
-		}
+	private:
+		size_t _want;
+		bool _mirrored;
+		bool _ring = false;
+		char * _data = nullptr;
+		size_t _capacity = 0;
+		size_t _head = 0;
+		size_t _size = 0;
+	};
 
-		void sunion( std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+	inline std::string sha1_hex( std::string_view data )
+	{
+		auto rol = []( uint32_t x, int n ) { return ( x << n ) | ( x >> ( 32 - n ) ); };
+
+		uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+		std::string msg( data );
+		uint64_t bits = uint64_t( data.size() ) * 8;
+		msg.push_back( char( 0x80 ) );
+		while ( msg.size() % 64 != 56 )
+			msg.push_back( 0 );
+		for ( int i = 7; i >= 0; --i )
+			msg.push_back( char( bits >> ( i * 8 ) ) );
+
+		for ( size_t off = 0; off < msg.size(); off += 64 )
 		{
-			std::vector<std::string_view> args{ "SUNION", key };
-			args.insert( args.end(), keys.begin(), keys.end() );
-			command( args, std::move( callback ) );
+			uint32_t w[80];
+			for ( int i = 0; i < 16; ++i )
+			{
+				const unsigned char * p = reinterpret_cast<const unsigned char *>( msg.data() + off + i * 4 );
+				w[i] = ( uint32_t( p[0] ) << 24 ) | ( uint32_t( p[1] ) << 16 ) | ( uint32_t( p[2] ) << 8 ) | uint32_t( p[3] );
+			}
+			for ( int i = 16; i < 80; ++i )
+				w[i] = rol( w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1 );
+
+			uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+			for ( int i = 0; i < 80; ++i )
+			{
+				uint32_t f, k;
+				if ( i < 20 ) { f = ( b & c ) | ( ~b & d ); k = 0x5A827999; }
+				else if ( i < 40 ) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+				else if ( i < 60 ) { f = ( b & c ) | ( b & d ) | ( c & d ); k = 0x8F1BBCDC; }
+				else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+				uint32_t t = rol( a, 5 ) + f + e + k + w[i];
+				e = d; d = c; c = rol( b, 30 ); b = a; a = t;
+			}
+
+			h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
 		}
 
-		void sunionstore( std::string_view destination, std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		static constexpr char hex[] = "0123456789abcdef";
+
+		std::string result;
+		result.reserve( 40 );
+		for ( uint32_t v : h )
+			for ( int i = 28; i >= 0; i -= 4 )
+				result.push_back( hex[( v >> i ) & 0xF] );
+
+		return result;
+	}
+
+	inline uint16_t hash_slot( std::string_view key )
+	{
+		auto beg = key.find( '{' );
+		if ( beg != std::string_view::npos )
 		{
-			std::vector<std::string_view> args{ "SUNIONSTORE", destination, key };
-			args.insert( args.end(), keys.begin(), keys.end() );
-			command( args, std::move( callback ) );
+			auto end = key.find( '}', beg + 1 );
+			if ( end != std::string_view::npos && end != beg + 1 )
+				key = key.substr( beg + 1, end - beg - 1 );
 		}
 
-		void sscan( std::string_view key, int cursor, std::string_view pattern, int count, result_callback_t callback )
+		uint16_t crc = 0;
+		for ( unsigned char c : key )
 		{
-			command( { "SSCAN", key, std::to_string( cursor ), pattern, std::to_string( count ) }, std::move( callback ) );
+			crc ^= uint16_t( c ) << 8;
+			for ( int i = 0; i < 8; ++i )
+				crc = ( crc & 0x8000 ) ? uint16_t( ( crc << 1 ) ^ 0x1021 ) : uint16_t( crc << 1 );
 		}
 
+		return crc & 16383;
+	}
+
+	class script
+	{
 	public:
-		void publish( std::string_view key, std::string_view msg, result_callback_t callback )
+		explicit script( std::string_view body )
+			: _body( std::make_shared<const std::string>( body ) ), _sha1( std::make_shared<const std::string>( sha1_hex( body ) ) )
 		{
-			command( { "PUBLISH", key, msg }, std::move( callback ) );
 		}
 
-		void subscribe( std::string_view key, result_callback_t callback )
+	public:
+		const std::string & body() const
 		{
-			command( { "SUBSCRIBE", key }, std::move( callback ), key );
+			return *_body;
 		}
 
-		void unsubscribe( std::string_view key, result_callback_t callback )
+		const std::string & sha1() const
 		{
-			command( { "UNSUBSCRIBE", key }, std::move( callback ) );
+			return *_sha1;
 		}
 
 	private:
-		void consume_message( const redis::value & val )
+		std::shared_ptr<const std::string> _body;
+		std::shared_ptr<const std::string> _sha1;
+	};
+
+	struct scan_options
+	{
+		std::string match;
+		uint64_t count = 0;
+		std::string type; // SCAN only
+	};
+
+	// One hash field of a schema: its name in Redis and the struct member it maps to
+	template< typename T, typename M > struct hash_field
+	{
+		std::string_view name;
+		M T::* member;
+	};
+
+	template< typename T, typename M > constexpr hash_field< T, M > field( std::string_view name, M T::* member )
+	{
+		return { name, member };
+	}
+
+	// Specialize once per struct stored as a hash; the order of fields is the HMGET order
+	//
+	//   template<> struct redis::hash_schema< user >
+	//   {
+	//       static constexpr auto fields = std::make_tuple( redis::field( "name", &user::name ), redis::field( "age", &user::age ) );
+	//   };
+	//
+	// Members may be std::string, bool or any arithmetic type.
+	template< typename T > struct hash_schema;
+
+	template< typename T > struct hash_object
+	{
+		static constexpr size_t size = std::tuple_size_v< std::decay_t< decltype( hash_schema< T >::fields ) > >;
+
+		// numbers are formatted into scratch, strings are referenced in place
+		using scratch_t = std::array< std::array< char, 32 >, size >;
+
+		// HSET key name value ... with every field of the schema
+		static std::vector< std::string_view > hset_args( std::string_view key, const T & object, scratch_t & scratch )
 		{
-			if ( val.is_array() )
+			std::vector< std::string_view > args;
+			args.reserve( 2 + size * 2 );
+			args.push_back( "HSET" );
+			args.push_back( key );
+
+			size_t i = 0;
+			std::apply( [&]( const auto & ... f )
 			{
-				std::string_view cmd = val.get_array()[0].get_string();
+				( ( args.push_back( f.name ), args.push_back( format( object.*f.member, scratch[i++] ) ) ), ... );
+			}, hash_schema< T >::fields );
+
+			return args;
+		}
+
+		// HMGET key name ... in schema order
+		static std::vector< std::string_view > hmget_args( std::string_view key )
+		{
+			std::vector< std::string_view > args;
+			args.reserve( 2 + size );
+			args.push_back( "HMGET" );
+			args.push_back( key );
+
+			std::apply( [&]( const auto & ... f ) { ( args.push_back( f.name ), ... ); }, hash_schema< T >::fields );
+
+			return args;
+		}
+
+		// Decodes an HMGET reply positionally; nil fields keep their current value. found tells whether any field
+		// was present, false means a malformed reply or a number that does not parse.
+		static bool decode( const redis::value & reply, T & object, bool & found )
+		{
+			found = false;
+
+			if ( !reply.is_ok() || !reply.is_array() || reply.get_array().size() != size )
+				return false;
+
+			const auto & items = reply.get_array();
+
+			size_t i = 0;
+			bool ok = true;
+			std::apply( [&]( const auto & ... f )
+			{
+				( ( ok = ok && parse( items[i++], object.*f.member, found ) ), ... );
+			}, hash_schema< T >::fields );
+
+			return ok;
+		}
+
+	private:
+		template< typename M > static std::string_view format( const M & member, std::array< char, 32 > & buf )
+		{
+			if constexpr ( std::is_convertible_v< const M &, std::string_view > )
+			{
+				return member;
+			}
+			else if constexpr ( std::is_same_v< M, bool > )
+			{
+				return member ? "1" : "0";
+			}
+			else
+			{
+				static_assert( std::is_arithmetic_v< M >, "hash_schema members must be strings, bool or arithmetic" );
+
+				auto result = std::to_chars( buf.data(), buf.data() + buf.size(), member );
+				return std::string_view( buf.data(), result.ptr - buf.data() );
+			}
+		}
+
+		template< typename M > static bool parse( const redis::value & item, M & member, bool & found )
+		{
+			if ( item.is_null() )
+				return true;
+			if ( !item.is_string() )
+				return false;
+
+			found = true;
+
+			const std::string & str = item.get_string();
+
+			if constexpr ( std::is_same_v< M, std::string > )
+			{
+				member = str;
+				return true;
+			}
+			else if constexpr ( std::is_same_v< M, bool > )
+			{
+				int i = 0;
+				auto result = std::from_chars( str.data(), str.data() + str.size(), i );
+				member = i != 0;
+				return result.ec == std::errc() && result.ptr == str.data() + str.size();
+			}
+			else
+			{
+				static_assert( std::is_arithmetic_v< M >, "hash_schema members must be strings, bool or arithmetic" );
+
+				auto result = std::from_chars( str.data(), str.data() + str.size(), member );
+				return result.ec == std::errc() && result.ptr == str.data() + str.size();
+			}
+		}
+	};
+
+	// Lock-free log-linear latency histogram, 32 sub buckets per power of two (about 3% precision)
+	class histogram
+	{
+	public:
+		static constexpr size_t buckets = 64 + 58 * 32;
+
+	public:
+		histogram() = default;
+
+		histogram( const histogram & other )
+		{
+			merge( other );
+		}
+
+	public:
+		void record( uint64_t v )
+		{
+			_counts[index( v )].fetch_add( 1, std::memory_order_relaxed );
+			_total.fetch_add( 1, std::memory_order_relaxed );
+			_sum.fetch_add( v, std::memory_order_relaxed );
+
+			uint64_t max = _max.load( std::memory_order_relaxed );
+			while ( v > max && !_max.compare_exchange_weak( max, v, std::memory_order_relaxed ) );
+		}
+
+		void merge( const histogram & other )
+		{
+			for ( size_t i = 0; i < buckets; ++i )
+				_counts[i].fetch_add( other._counts[i].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+			_total.fetch_add( other.total(), std::memory_order_relaxed );
+			_sum.fetch_add( other.sum(), std::memory_order_relaxed );
+
+			uint64_t v = other.max(), max = _max.load( std::memory_order_relaxed );
+			while ( v > max && !_max.compare_exchange_weak( max, v, std::memory_order_relaxed ) );
+		}
+
+		uint64_t percentile( double p ) const
+		{
+			uint64_t target = uint64_t( p / 100.0 * total() ), seen = 0;
+			for ( size_t i = 0; i < buckets; ++i )
+			{
+				seen += _counts[i].load( std::memory_order_relaxed );
+				if ( seen > target )
+					return std::min( highest( i ), max() );
+			}
+			return max();
+		}
+
+		uint64_t total() const
+		{
+			return _total.load( std::memory_order_relaxed );
+		}
+
+		uint64_t sum() const
+		{
+			return _sum.load( std::memory_order_relaxed );
+		}
+
+		uint64_t max() const
+		{
+			return _max.load( std::memory_order_relaxed );
+		}
+
+	private:
+		static size_t index( uint64_t v )
+		{
+			if ( v < 64 )
+				return size_t( v );
+
+			int msb = 63;
+			while ( ( v >> msb ) == 0 )
+				--msb;
+
+			int e = msb - 5;
+			return 64 + ( e - 1 ) * 32 + size_t( ( v >> e ) - 32 );
+		}
+
+		static uint64_t highest( size_t i )
+		{
+			if ( i < 64 )
+				return i;
+
+			int e = int( ( i - 64 ) / 32 ) + 1;
+			uint64_t sub = ( i - 64 ) % 32 + 32;
+			return ( ( sub + 1 ) << e ) - 1;
+		}
+
+	private:
+		std::array< std::atomic< uint64_t >, buckets > _counts = {};
+		std::atomic< uint64_t > _total = 0;
+		std::atomic< uint64_t > _sum = 0;
+		std::atomic< uint64_t > _max = 0;
+	};
+
+	struct metrics_snapshot
+	{
+		struct command_t
+		{
+			std::string name;
+			uint64_t count = 0;
+			uint64_t errors = 0;
+			uint64_t bytes = 0;
+			uint64_t completed = 0;
+			uint64_t latency_sum_ns = 0;
+			uint64_t p50_ns = 0, p90_ns = 0, p99_ns = 0, p999_ns = 0, max_ns = 0;
+		};
+
+		std::vector< command_t > commands;
+		uint64_t queue_depth = 0;
+		uint64_t max_queue_depth = 0;
+		uint64_t bytes_encoded = 0;
+		uint64_t bytes_parsed = 0;
+		uint64_t replies = 0;
+		uint64_t parse_errors = 0;
+		uint64_t parse_ns = 0;
+		uint64_t callback_ns = 0;
+
+		// Prometheus text exposition format
+		std::string prometheus( std::string_view prefix = "redis_client" ) const
+		{
+			std::string out;
+			auto line = [&]( std::string_view name, std::string_view labels, uint64_t v )
+			{
+				out.append( prefix ).append( "_" ).append( name );
+				if ( !labels.empty() )
+					out.append( "{" ).append( labels ).append( "}" );
+				out.append( " " ).append( std::to_string( v ) ).append( "\n" );
+			};
+
+			line( "queue_depth", {}, queue_depth );
+			line( "max_queue_depth", {}, max_queue_depth );
+			line( "bytes_encoded_total", {}, bytes_encoded );
+			line( "bytes_parsed_total", {}, bytes_parsed );
+			line( "replies_total", {}, replies );
+			line( "parse_errors_total", {}, parse_errors );
+			line( "parse_nanoseconds_total", {}, parse_ns );
+			line( "callback_nanoseconds_total", {}, callback_ns );
+
+			for ( const auto & it : commands )
+			{
+				std::string cmd = "command=\"" + it.name + "\"";
+				line( "commands_total", cmd, it.count );
+				line( "command_errors_total", cmd, it.errors );
+				line( "command_bytes_total", cmd, it.bytes );
+				line( "command_latency_nanoseconds", cmd + ",quantile=\"0.5\"", it.p50_ns );
+				line( "command_latency_nanoseconds", cmd + ",quantile=\"0.9\"", it.p90_ns );
+				line( "command_latency_nanoseconds", cmd + ",quantile=\"0.99\"", it.p99_ns );
+				line( "command_latency_nanoseconds", cmd + ",quantile=\"0.999\"", it.p999_ns );
+				line( "command_latency_nanoseconds_sum", cmd, it.latency_sum_ns );
+				line( "command_latency_nanoseconds_count", cmd, it.completed );
+			}
+
+			return out;
+		}
+	};
+
+	// Per command name counters in a fixed open addressing table, inserted and updated without locks
+	class metrics
+	{
+	public:
+		struct command_stats
+		{
+			std::atomic< uint64_t > count = 0;
+			std::atomic< uint64_t > errors = 0;
+			std::atomic< uint64_t > bytes = 0;
+			histogram latency;
+		};
+
+		static constexpr size_t capacity = 256;
+		static constexpr size_t name_size = 32;
+
+	public:
+		~metrics()
+		{
+			for ( auto & it : _slots )
+				delete it.stats.load();
+		}
+
+	public:
+		static uint64_t now()
+		{
+			return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+		}
+
+		// Returns nullptr when the table is full
+		command_stats * find( std::string_view name )
+		{
+			char key[name_size] = {};
+			for ( size_t i = 0; i < name.size() && i < name_size - 1; ++i )
+				key[i] = char( toupper( name[i] ) );
+
+			size_t hash = std::hash< std::string_view >()( std::string_view( key ) );
+
+			for ( size_t n = 0; n < capacity; ++n )
+			{
+				slot_t & slot = _slots[( hash + n ) % capacity];
+
+				int state = slot.state.load( std::memory_order_acquire );
+				if ( state == Empty && slot.state.compare_exchange_strong( state, Writing, std::memory_order_acq_rel ) )
+				{
+					std::memcpy( slot.name, key, name_size );
+					slot.stats.store( new command_stats(), std::memory_order_relaxed );
+					slot.state.store( Ready, std::memory_order_release );
+					return slot.stats.load( std::memory_order_relaxed );
+				}
+
+				while ( state == Writing )
+					state = slot.state.load( std::memory_order_acquire );
+
+				if ( std::memcmp( slot.name, key, name_size ) == 0 )
+					return slot.stats.load( std::memory_order_relaxed );
+			}
+
+			return nullptr;
+		}
+
+		metrics_snapshot snapshot() const
+		{
+			metrics_snapshot result;
+
+			for ( const auto & slot : _slots )
+			{
+				if ( slot.state.load( std::memory_order_acquire ) != Ready )
+					continue;
+
+				const command_stats & stats = *slot.stats.load( std::memory_order_relaxed );
+
+				metrics_snapshot::command_t cmd;
+				cmd.name = slot.name;
+				cmd.count = stats.count.load( std::memory_order_relaxed );
+				cmd.errors = stats.errors.load( std::memory_order_relaxed );
+				cmd.bytes = stats.bytes.load( std::memory_order_relaxed );
+				cmd.completed = stats.latency.total();
+				cmd.latency_sum_ns = stats.latency.sum();
+				cmd.p50_ns = stats.latency.percentile( 50 );
+				cmd.p90_ns = stats.latency.percentile( 90 );
+				cmd.p99_ns = stats.latency.percentile( 99 );
+				cmd.p999_ns = stats.latency.percentile( 99.9 );
+				cmd.max_ns = stats.latency.max();
+				result.commands.push_back( std::move( cmd ) );
+			}
+
+			result.queue_depth = queue_depth.load( std::memory_order_relaxed );
+			result.max_queue_depth = max_queue_depth.load( std::memory_order_relaxed );
+			result.bytes_encoded = bytes_encoded.load( std::memory_order_relaxed );
+			result.bytes_parsed = bytes_parsed.load( std::memory_order_relaxed );
+			result.replies = replies.load( std::memory_order_relaxed );
+			result.parse_errors = parse_errors.load( std::memory_order_relaxed );
+			result.parse_ns = parse_ns.load( std::memory_order_relaxed );
+			result.callback_ns = callback_ns.load( std::memory_order_relaxed );
+
+			return result;
+		}
+
+	public:
+		std::atomic< uint64_t > queue_depth = 0;
+		std::atomic< uint64_t > max_queue_depth = 0;
+		std::atomic< uint64_t > bytes_encoded = 0;
+		std::atomic< uint64_t > bytes_parsed = 0;
+		std::atomic< uint64_t > replies = 0;
+		std::atomic< uint64_t > parse_errors = 0;
+		std::atomic< uint64_t > parse_ns = 0;
+		std::atomic< uint64_t > callback_ns = 0;
+
+	private:
+		enum
+		{
+			Empty,
+			Writing,
+			Ready,
+		};
+
+		struct slot_t
+		{
+			std::atomic< int > state = Empty;
+			char name[name_size] = {};
+			std::atomic< command_stats * > stats = nullptr;
+		};
+
+		std::array< slot_t, capacity > _slots;
+	};
+
+	enum class overload_policy
+	{
+		Signal, // accept and only report through on_pressure
+		Reject, // fail new commands with overload_error while paused
+		Block,  // block the calling thread until drained below the low marks; commands issued from a reply
+		        // callback on the reading thread, or from the thread set by set_reader_thread(), are admitted
+		        // instead, since blocking there stops the draining
+	};
+
+	struct flow_options
+	{
+		size_t high_requests = 0; // 0 disables the limit
+		size_t low_requests = 0;
+		size_t high_bytes = 0;    // 0 disables the limit
+		size_t low_bytes = 0;
+		overload_policy policy = overload_policy::Signal;
+		std::function< void( bool paused ) > on_pressure;
+	};
+
+	class client
+	{
+	public:
+		using result_callback_t = std::function< void( redis::value ) >;
+		using output_callback_t = std::function< void( std::string_view ) >;
+
+	private:
+		struct pending_t
+		{
+			result_callback_t callback;
+			size_t bytes = 0;
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+			metrics::command_stats * stats = nullptr;
+			uint64_t start = 0;
+#endif
+		};
+
+	public:
+		client( output_callback_t out_cb )
+			:_output( out_cb )
+		{ }
+
+		~client() = default;
+
+	public:
+		template< typename Iterator > Iterator input( Iterator beg, Iterator end )
+		{
+			std::unique_lock< std::mutex > lock( _rmutex );
+			reader_guard reader( _reader );
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+			uint64_t start = metrics::now(), callback = _metrics.callback_ns.load( std::memory_order_relaxed );
+			_metrics.bytes_parsed.fetch_add( std::distance( beg, end ), std::memory_order_relaxed );
+#endif
+
+			Iterator cur = beg;
+
+			while ( cur != end )
+			{
+				auto result = _parser.parse( cur, end );
+
+				if ( result.second == parser::Completed )
+				{
+					consume_message( _parser.take() );
+					std::advance( cur, result.first );
+				}
+				else if ( result.second == parser::Incompleted )
+				{
+					std::advance( cur, result.first );
+					break;
+				}
+				else
+				{
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+					_metrics.parse_errors.fetch_add( 1, std::memory_order_relaxed );
+#endif
+					consume_message( redis::value( redis::value::redis_parse_error, "redis parse error" ) );
+					
+					cur = end;
+					break;
+				}
+			}
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+			// everything not spent in callbacks is parsing and dispatch
+			uint64_t elapsed = metrics::now() - start, in_callbacks = _metrics.callback_ns.load( std::memory_order_relaxed ) - callback;
+			_metrics.parse_ns.fetch_add( elapsed > in_callbacks ? elapsed - in_callbacks : 0, std::memory_order_relaxed );
+#endif
+
+			return cur;
+		}
+
+		// The client's own read buffer: a transport reads straight into prepare() and passes the byte count to
+		// commit(), which parses whole replies in place. Use either this or input() on a connection, not both.
+		std::pair< char *, size_t > prepare()
+		{
+			std::unique_lock< std::mutex > lock( _rmutex );
+
+			return _rbuf.prepare();
+		}
+
+		void commit( size_t size )
+		{
+			std::unique_lock< std::mutex > lock( _rmutex );
+			reader_guard reader( _reader );
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+			uint64_t start = metrics::now(), callback = _metrics.callback_ns.load( std::memory_order_relaxed );
+			_metrics.bytes_parsed.fetch_add( size, std::memory_order_relaxed );
+#endif
+
+			_rbuf.commit( size );
+
+			while ( true )
+			{
+				std::string_view data = _rbuf.data();
+
+				// a bulk reply still short of its announced size is not rescanned
+				if ( data.empty() || data.size() < _parser.needed() )
+					break;
+
+				auto result = _parser.parse_whole( data.data(), data.data() + data.size() );
+
+				if ( result.second == parser::Completed )
+				{
+					_rbuf.consume( result.first );
+					consume_message( _parser.take() );
+				}
+				else if ( result.second == parser::Incompleted )
+				{
+					_rbuf.reserve( _parser.needed() );
+					break;
+				}
+				else
+				{
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+					_metrics.parse_errors.fetch_add( 1, std::memory_order_relaxed );
+#endif
+					consume_message( redis::value( redis::value::redis_parse_error, "redis parse error" ) );
+
+					_rbuf.clear();
+					break;
+				}
+			}
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+			uint64_t elapsed = metrics::now() - start, in_callbacks = _metrics.callback_ns.load( std::memory_order_relaxed ) - callback;
+			_metrics.parse_ns.fetch_add( elapsed > in_callbacks ? elapsed - in_callbacks : 0, std::memory_order_relaxed );
+#endif
+		}
+
+		// Fails every pending callback with io_error and drops any partially parsed reply, e.g. after the connection
+		// was lost. flush runs under the write lock so a transport can discard its unsent bytes together with them.
+		void reset( const std::function< void() > & flush = nullptr )
+		{
+			std::unique_lock< std::mutex > rlock( _rmutex );
+			reader_guard reader( _reader );
+
+			std::deque<pending_t> handler;
+			bool resumed = false;
+			{
+				std::unique_lock< std::mutex > lock( _wmutex );
+
+				handler.swap( _handler );
+				_inflight_bytes = 0;
+				_parser = redis::parser();
+				_rbuf.clear();
+
+				if ( flush )
+					flush();
+
+				if ( _paused )
+				{
+					_paused = false;
+					_drained.notify_all();
+					resumed = _flow.on_pressure != nullptr;
+				}
+			}
+
+			if ( resumed )
+				_flow.on_pressure( false );
+
+			for ( auto & it : handler )
+			{
+				if ( it.callback )
+					it.callback( redis::value( redis::value::io_error, "connection reset" ) );
+			}
+		}
+
+	public:
+		static void encode( std::string & out, const std::vector< std::string_view > & args )
+		{
+			out.append( "*" ).append( std::to_string( args.size() ) ).append( CRCF );
+
+			for ( const auto & item : args )
+			{
+				out.append( "$" ).append( std::to_string( item.size() ) ).append( CRCF );
+				out.append( item ).append( CRCF );
+			}
+		}
+
+		void command( const std::vector< std::string_view > & args, result_callback_t callback, std::string_view subscribe_key = {} )
+		{
+			std::string cmd;
+
+			encode( cmd, args );
+
+			if( _output != nullptr )
+			{
+				bool paused = false;
+				{
+					std::unique_lock< std::mutex >lock( _wmutex );
+
+					if ( subscribe_key.empty() )
+					{
+						if ( !admit( lock ) )
+						{
+							lock.unlock();
+							reject( callback );
+							return;
+						}
+
+						_handler.push_back( { std::move( callback ), cmd.size() } );
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+						track( _handler.back(), args.empty() ? std::string_view() : args[0], cmd.size() );
+#endif
+						paused = charge( cmd.size() );
+					}
+					else
+					{
+						_subscribe_handler.insert( { std::string( subscribe_key.begin(), subscribe_key.end() ), std::move( callback ) } );
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+						_metrics.bytes_encoded.fetch_add( cmd.size(), std::memory_order_relaxed );
+#endif
+					}
+
+					_output( cmd );
+				}
+
+				if ( paused )
+					_flow.on_pressure( true );
+			}
+		}
+
+		// Writes several already encoded commands with a single output call, one callback per reply
+		void pipeline( std::string_view cmds, std::vector< result_callback_t > callbacks )
+		{
+			if ( _output != nullptr && !callbacks.empty() )
+			{
+				bool paused = false;
+				{
+					std::unique_lock< std::mutex >lock( _wmutex );
+
+					if ( !admit( lock ) )
+					{
+						lock.unlock();
+						for ( auto & it : callbacks )
+							reject( it );
+						return;
+					}
+
+					// the bytes are released with the last reply of the batch
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+					size_t pos = 0;
+#endif
+					for ( size_t i = 0; i < callbacks.size(); ++i )
+					{
+						_handler.push_back( { std::move( callbacks[i] ), i + 1 == callbacks.size() ? cmds.size() : 0 } );
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+						size_t beg = pos;
+						std::string_view name = next_command( cmds, pos );
+						track( _handler.back(), name, pos - beg );
+#endif
+					}
+					paused = charge( cmds.size() );
+
+					_output( cmds );
+				}
+
+				if ( paused )
+					_flow.on_pressure( true );
+			}
+		}
+
+	public:
+		void set_flow_control( flow_options options )
+		{
+			std::unique_lock< std::mutex > lock( _wmutex );
+			_flow = std::move( options );
+		}
+
+		size_t inflight_requests() const
+		{
+			std::unique_lock< std::mutex > lock( _wmutex );
+			return _handler.size();
+		}
+
+		size_t inflight_bytes() const
+		{
+			std::unique_lock< std::mutex > lock( _wmutex );
+			return _inflight_bytes;
+		}
+
+		bool paused() const
+		{
+			std::unique_lock< std::mutex > lock( _wmutex );
+			return _paused;
+		}
+
+		// The event loop thread that feeds this client its replies, which must never wait under
+		// overload_policy::Block; transports that own such a thread set it, e.g. redis::uring_loop
+		void set_reader_thread( std::thread::id id )
+		{
+			_drainer.store( id, std::memory_order_relaxed );
+		}
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+	public:
+		metrics_snapshot snapshot() const
+		{
+			return _metrics.snapshot();
+		}
+#endif
+
+	public:
+		void ping( result_callback_t callback )
+		{
+			command( { "PING" }, std::move( callback ) );
+		}
+
+		void echo( std::string_view message, result_callback_t callback )
+		{
+			command( { "ECHO", message }, std::move( callback ) );
+		}
+
+		void auth( std::string_view password, result_callback_t callback )
+		{
+			command( { "AUTH", password }, std::move( callback ) );
+		}
+
+		void select( int index, result_callback_t callback )
+		{
+			command( { "SELECT", std::to_string( index ) }, std::move( callback ) );
+		}
+
+		void quit( result_callback_t callback )
+		{
+			command( { "QUIT" }, std::move( callback ) );
+		}
+
+	public:
+		void set( std::string_view key, std::string_view value, result_callback_t callback )
+		{
+			command( { "SET", key, value }, std::move( callback ) );
+		}
+
+		void get( std::string_view key, result_callback_t callback )
+		{
+			command( { "GET", key }, std::move( callback ) );
+		}
+
+		void del( std::string_view key, result_callback_t callback )
+		{
+			command( { "DEL", key }, std::move( callback ) );
+		}
+
+	public:
+		void hset( std::string_view key, std::string_view field, std::string_view value, result_callback_t callback )
+		{
+			command( { "HSET", key, field, value }, std::move( callback ) );
+		}
+
+		void hget( std::string_view key, std::string_view field, result_callback_t callback )
+		{
+			command( { "HGET", key, field }, std::move( callback ) );
+		}
+
+		void hdel( std::string_view key, std::string_view field, result_callback_t callback )
+		{
+			command( { "HDEL", key, field }, std::move( callback ) );
+		}
+
+		// Writes every field of a struct declared with hash_schema in one HSET
+		template< typename T > void hset_object( std::string_view key, const T & object, result_callback_t callback )
+		{
+			typename hash_object< T >::scratch_t scratch;
+			command( hash_object< T >::hset_args( key, object, scratch ), std::move( callback ) );
+		}
+
+		// Reads a struct back with one HMGET; the object is empty when the hash does not exist or fails to decode
+		template< typename T > void hget_object( std::string_view key, std::function< void( const redis::value &, std::optional< T > ) > callback )
+		{
+			command( hash_object< T >::hmget_args( key ), [callback = std::move( callback )]( redis::value result )
+			{
+				if ( !callback )
+					return;
+
+				T object{};
+				bool found = false;
+
+				if ( !result.is_ok() )
+					callback( result, std::nullopt );
+				else if ( !hash_object< T >::decode( result, object, found ) )
+					callback( redis::value( redis::value::redis_parse_error, "hash does not match its schema" ), std::nullopt );
+				else if ( !found )
+					callback( result, std::nullopt );
+				else
+					callback( result, std::move( object ) );
+			} );
+		}
+
+	public:
+		void sadd( std::string_view key, const std::vector<std::string_view> & members, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SADD", key };
+			args.insert( args.end(), members.begin(), members.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void scard( std::string_view key, result_callback_t callback )
+		{
+			command( { "SCARD", key }, std::move( callback ) );
+		}
+
+		void sdiff( std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SDIFF", key };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sdiffstore( std::string_view destination, std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SDIFFSTORE", destination, key };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sinter( std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SINTER", key };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sinterstore( std::string_view destination, std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SINTERSTORE", destination, key };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sismember( std::string_view key, std::string_view member, result_callback_t callback )
+		{
+			command( { "SISMEMBER", key, member }, std::move( callback ) );
+		}
+
+		void smembers( std::string_view key, result_callback_t callback )
+		{
+			command( { "SMEMBERS", key }, std::move( callback ) );
+		}
+
+		void smove( std::string_view source, std::string_view destination, std::string_view member, result_callback_t callback )
+		{
+			command( { "SMOVE", source, destination, member }, std::move( callback ) );
+		}
+
+		void spop( std::string_view key, result_callback_t callback )
+		{
+			command( { "SPOP", key }, std::move( callback ) );
+		}
+
+		void srandmember( std::string_view key, result_callback_t callback )
+		{
+			command( { "SRANDMEMBER", key }, std::move( callback ) );
+		}
+
+		void srandmember( std::string_view key, int count, result_callback_t callback )
+		{
+			command( { "SRANDMEMBER", key, std::to_string( count ) }, std::move( callback ) );
+		}
+
+		void srem( std::string_view key, std::string_view member, const std::vector<std::string_view> & members, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SREM", key, member };
+			args.insert( args.end(), members.begin(), members.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sunion( std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SUNION", key };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sunionstore( std::string_view destination, std::string_view key, const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SUNIONSTORE", destination, key };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void sscan( std::string_view key, uint64_t cursor, std::string_view pattern, int count, result_callback_t callback )
+		{
+			command( { "SSCAN", key, std::to_string( cursor ), "MATCH", pattern, "COUNT", std::to_string( count ) }, std::move( callback ) );
+		}
+
+	public:
+		void scan( uint64_t cursor, const scan_options & options, result_callback_t callback )
+		{
+			scan_command( "SCAN", {}, cursor, options, std::move( callback ) );
+		}
+
+		void sscan( std::string_view key, uint64_t cursor, const scan_options & options, result_callback_t callback )
+		{
+			scan_command( "SSCAN", key, cursor, options, std::move( callback ) );
+		}
+
+		void hscan( std::string_view key, uint64_t cursor, const scan_options & options, result_callback_t callback )
+		{
+			scan_command( "HSCAN", key, cursor, options, std::move( callback ) );
+		}
+
+		void zscan( std::string_view key, uint64_t cursor, const scan_options & options, result_callback_t callback )
+		{
+			scan_command( "ZSCAN", key, cursor, options, std::move( callback ) );
+		}
+
+		void scan_command( std::string_view cmd, std::string_view key, uint64_t cursor, const scan_options & options, result_callback_t callback )
+		{
+			std::string cur = std::to_string( cursor ), count = std::to_string( options.count );
+
+			std::vector<std::string_view> args{ cmd };
+			if ( !key.empty() )
+				args.push_back( key );
+			args.push_back( cur );
+			if ( !options.match.empty() )
+				args.insert( args.end(), { "MATCH", options.match } );
+			if ( options.count != 0 )
+				args.insert( args.end(), { "COUNT", count } );
+			if ( !options.type.empty() && key.empty() )
+				args.insert( args.end(), { "TYPE", options.type } );
+
+			command( args, std::move( callback ) );
+		}
+
+	public:
+		void watch( const std::vector<std::string_view> & keys, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "WATCH" };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void unwatch( result_callback_t callback )
+		{
+			command( { "UNWATCH" }, std::move( callback ) );
+		}
+
+		void multi( result_callback_t callback )
+		{
+			command( { "MULTI" }, std::move( callback ) );
+		}
+
+		void exec( result_callback_t callback )
+		{
+			command( { "EXEC" }, std::move( callback ) );
+		}
+
+		void discard( result_callback_t callback )
+		{
+			command( { "DISCARD" }, std::move( callback ) );
+		}
+
+	public:
+		void eval( std::string_view script, const std::vector<std::string_view> & keys, const std::vector<std::string_view> & argv, result_callback_t callback )
+		{
+			std::string numkeys = std::to_string( keys.size() );
+			std::vector<std::string_view> args{ "EVAL", script, numkeys };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			args.insert( args.end(), argv.begin(), argv.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void evalsha( std::string_view sha1, const std::vector<std::string_view> & keys, const std::vector<std::string_view> & argv, result_callback_t callback )
+		{
+			std::string numkeys = std::to_string( keys.size() );
+			std::vector<std::string_view> args{ "EVALSHA", sha1, numkeys };
+			args.insert( args.end(), keys.begin(), keys.end() );
+			args.insert( args.end(), argv.begin(), argv.end() );
+			command( args, std::move( callback ) );
+		}
+
+		// Sends EVALSHA and only falls back to EVAL, which also loads the script, when the server replies NOSCRIPT
+		void eval( const redis::script & script, const std::vector<std::string_view> & keys, const std::vector<std::string_view> & argv, result_callback_t callback )
+		{
+			std::vector<std::string> params( keys.begin(), keys.end() );
+			params.insert( params.end(), argv.begin(), argv.end() );
+
+			evalsha( script.sha1(), keys, argv, [this, script, numkeys = keys.size(), params = std::move( params ), callback = std::move( callback )]( redis::value result ) mutable
+			{
+				if ( result.is_error() && result.get_string().compare( 0, 8, "NOSCRIPT" ) == 0 )
+				{
+					std::vector<std::string_view> keys( params.begin(), params.begin() + numkeys );
+					std::vector<std::string_view> argv( params.begin() + numkeys, params.end() );
+
+					eval( script.body(), keys, argv, std::move( callback ) );
+				}
+				else
+				{
+					callback( std::move( result ) );
+				}
+			} );
+		}
+
+		void script_load( std::string_view script, result_callback_t callback )
+		{
+			command( { "SCRIPT", "LOAD", script }, std::move( callback ) );
+		}
+
+		void script_load( const redis::script & script, result_callback_t callback )
+		{
+			script_load( script.body(), std::move( callback ) );
+		}
+
+		void script_exists( const std::vector<std::string_view> & sha1s, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "SCRIPT", "EXISTS" };
+			args.insert( args.end(), sha1s.begin(), sha1s.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void script_flush( result_callback_t callback )
+		{
+			command( { "SCRIPT", "FLUSH" }, std::move( callback ) );
+		}
+
+	public:
+		void xadd( std::string_view key, std::string_view id, const std::vector<std::pair<std::string_view, std::string_view>> & fields, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "XADD", key, id };
+			for ( const auto & it : fields )
+				args.insert( args.end(), { it.first, it.second } );
+			command( args, std::move( callback ) );
+		}
+
+		void xlen( std::string_view key, result_callback_t callback )
+		{
+			command( { "XLEN", key }, std::move( callback ) );
+		}
+
+		void xack( std::string_view key, std::string_view group, const std::vector<std::string_view> & ids, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "XACK", key, group };
+			args.insert( args.end(), ids.begin(), ids.end() );
+			command( args, std::move( callback ) );
+		}
+
+		void xgroup_create( std::string_view key, std::string_view group, std::string_view id, bool mkstream, result_callback_t callback )
+		{
+			std::vector<std::string_view> args{ "XGROUP", "CREATE", key, group, id };
+			if ( mkstream )
+				args.push_back( "MKSTREAM" );
+			command( args, std::move( callback ) );
+		}
+
+		void xreadgroup( std::string_view group, std::string_view consumer, std::string_view key, std::string_view id, size_t count, int block_ms, result_callback_t callback )
+		{
+			std::string cnt = std::to_string( count ), block = std::to_string( block_ms );
+
+			std::vector<std::string_view> args{ "XREADGROUP", "GROUP", group, consumer, "COUNT", cnt };
+			if ( block_ms >= 0 )
+				args.insert( args.end(), { "BLOCK", block } );
+			args.insert( args.end(), { "STREAMS", key, id } );
+			command( args, std::move( callback ) );
+		}
+
+		void xautoclaim( std::string_view key, std::string_view group, std::string_view consumer, uint64_t min_idle_ms, std::string_view start, size_t count, result_callback_t callback )
+		{
+			std::string idle = std::to_string( min_idle_ms ), cnt = std::to_string( count );
+			command( { "XAUTOCLAIM", key, group, consumer, idle, start, "COUNT", cnt }, std::move( callback ) );
+		}
+
+	public:
+		void publish( std::string_view key, std::string_view msg, result_callback_t callback )
+		{
+			command( { "PUBLISH", key, msg }, std::move( callback ) );
+		}
+
+		void subscribe( std::string_view key, result_callback_t callback )
+		{
+			command( { "SUBSCRIBE", key }, std::move( callback ), key );
+		}
+
+		void unsubscribe( std::string_view key, result_callback_t callback )
+		{
+			command( { "UNSUBSCRIBE", key }, std::move( callback ) );
+		}
+
+	private:
+		void consume_message( redis::value val )
+		{
+			if ( val.is_array() && !_subscribe_handler.empty() && !val.get_array().empty() && val.get_array()[0].is_string() )
+			{
+				std::string_view cmd = val.get_array()[0].get_string();
 
 				if ( cmd == "message" )
 				{
-					auto it = _subscribe_handler.find( val.get_array()[1].get_string() );
-					if ( it != _subscribe_handler.end() )
+					auto it = _subscribe_handler.find( val.get_array()[1].get_string() );
+					if ( it != _subscribe_handler.end() )
+					{
+						it->second( val.get_array()[2] );
+					}
+
+					return;
+				}
+				else if ( cmd == "subscribe" )
+				{
+					return;
+				}
+			}
+
+			result_callback_t handler;
+			bool resumed = false;
+			{
+				std::unique_lock< std::mutex > lock( _wmutex );
+
+				if ( _handler.empty() )
+					return;
+
+				handler = std::move( _handler.front().callback );
+				_inflight_bytes -= _handler.front().bytes;
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+				if ( _handler.front().stats != nullptr )
+				{
+					_handler.front().stats->latency.record( metrics::now() - _handler.front().start );
+					if ( val.is_error() )
+						_handler.front().stats->errors.fetch_add( 1, std::memory_order_relaxed );
+				}
+				_metrics.replies.fetch_add( 1, std::memory_order_relaxed );
+				_metrics.queue_depth.store( _handler.size() - 1, std::memory_order_relaxed );
+#endif
+				_handler.pop_front();
+
+				if ( _paused && ( _flow.high_requests == 0 || _handler.size() <= _flow.low_requests ) && ( _flow.high_bytes == 0 || _inflight_bytes <= _flow.low_bytes ) )
+				{
+					_paused = false;
+					_drained.notify_all();
+					resumed = _flow.on_pressure != nullptr;
+				}
+			}
+
+			if ( resumed )
+				_flow.on_pressure( false );
+
+			// called without the write lock so that a callback may issue the next command
+			if ( handler )
+			{
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+				uint64_t start = metrics::now();
+				handler( std::move( val ) );
+				_metrics.callback_ns.fetch_add( metrics::now() - start, std::memory_order_relaxed );
+#else
+				handler( std::move( val ) );
+#endif
+			}
+		}
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+		void track( pending_t & pending, std::string_view name, size_t bytes )
+		{
+			pending.stats = _metrics.find( name );
+			pending.start = metrics::now();
+
+			if ( pending.stats != nullptr )
+			{
+				pending.stats->count.fetch_add( 1, std::memory_order_relaxed );
+				pending.stats->bytes.fetch_add( bytes, std::memory_order_relaxed );
+			}
+
+			_metrics.bytes_encoded.fetch_add( bytes, std::memory_order_relaxed );
+			_metrics.queue_depth.store( _handler.size(), std::memory_order_relaxed );
+			if ( _handler.size() > _metrics.max_queue_depth.load( std::memory_order_relaxed ) )
+				_metrics.max_queue_depth.store( _handler.size(), std::memory_order_relaxed );
+		}
+
+		// Returns the name of the encoded command starting at pos and moves pos past it
+		static std::string_view next_command( std::string_view cmds, size_t & pos )
+		{
+			auto number = [&]()
+			{
+				size_t n = 0;
+				for ( ++pos; pos < cmds.size() && cmds[pos] != '\r'; ++pos )
+					n = n * 10 + size_t( cmds[pos] - '0' );
+				pos += 2;
+				return n;
+			};
+
+			std::string_view name;
+
+			if ( pos >= cmds.size() || cmds[pos] != '*' )
+			{
+				pos = cmds.size();
+				return name;
+			}
+
+			for ( size_t i = 0, count = number(); i < count && pos < cmds.size(); ++i )
+			{
+				size_t len = number();
+				if ( i == 0 )
+					name = cmds.substr( pos, len );
+				pos += len + 2;
+			}
+
+			return name;
+		}
+#endif
+
+		bool admit( std::unique_lock< std::mutex > & lock )
+		{
+			if ( !_paused )
+				return true;
+
+			switch ( _flow.policy )
+			{
+			case overload_policy::Reject:
+				return false;
+			case overload_policy::Block:
+				// the reading thread is the one that drains, so it never waits on itself
+				if ( _reader.load( std::memory_order_relaxed ) != std::this_thread::get_id() && _drainer.load( std::memory_order_relaxed ) != std::this_thread::get_id() )
+					_drained.wait( lock, [this]() { return !_paused; } );
+				return true;
+			default:
+				return true;
+			}
+		}
+
+		bool charge( size_t bytes )
+		{
+			_inflight_bytes += bytes;
+
+			if ( !_paused && ( ( _flow.high_requests != 0 && _handler.size() >= _flow.high_requests ) || ( _flow.high_bytes != 0 && _inflight_bytes >= _flow.high_bytes ) ) )
+			{
+				_paused = true;
+				return _flow.on_pressure != nullptr;
+			}
+
+			return false;
+		}
+
+		void reject( const result_callback_t & callback )
+		{
+			if ( callback )
+				callback( redis::value( redis::value::overload_error, "client overloaded" ) );
+		}
+
+	private:
+		// Marks the thread parsing replies and running their callbacks
+		struct reader_guard
+		{
+			reader_guard( std::atomic< std::thread::id > & reader )
+				: _reader( reader )
+			{
+				_reader.store( std::this_thread::get_id(), std::memory_order_relaxed );
+			}
+
+			~reader_guard()
+			{
+				_reader.store( std::thread::id(), std::memory_order_relaxed );
+			}
+
+			std::atomic< std::thread::id > & _reader;
+		};
+
+	private:
+		redis::parser _parser;
+		redis::read_buffer _rbuf;
+		output_callback_t _output;
+		mutable std::mutex _rmutex, _wmutex;
+		std::deque<pending_t> _handler;
+		std::map<std::string, result_callback_t> _subscribe_handler;
+
+		flow_options _flow;
+		bool _paused = false;
+		size_t _inflight_bytes = 0;
+		std::condition_variable _drained;
+		std::atomic< std::thread::id > _reader;
+		std::atomic< std::thread::id > _drainer;
+
+#ifdef REDIS_CLIENT_INSTRUMENTATION
+		redis::metrics _metrics;
+#endif
+	};
+
+	class transaction
+	{
+	public:
+		using result_callback_t = client::result_callback_t;
+
+	public:
+		transaction( redis::client & c )
+			: _client( c )
+		{
+		}
+
+	public:
+		void command( const std::vector< std::string_view > & args, result_callback_t callback )
+		{
+			client::encode( _cmds, args );
+			_callbacks.emplace_back( std::move( callback ) );
+		}
+
+		void set( std::string_view key, std::string_view value, result_callback_t callback )
+		{
+			command( { "SET", key, value }, std::move( callback ) );
+		}
+
+		void get( std::string_view key, result_callback_t callback )
+		{
+			command( { "GET", key }, std::move( callback ) );
+		}
+
+		void del( std::string_view key, result_callback_t callback )
+		{
+			command( { "DEL", key }, std::move( callback ) );
+		}
+
+		void hset( std::string_view key, std::string_view field, std::string_view value, result_callback_t callback )
+		{
+			command( { "HSET", key, field, value }, std::move( callback ) );
+		}
+
+		void hget( std::string_view key, std::string_view field, result_callback_t callback )
+		{
+			command( { "HGET", key, field }, std::move( callback ) );
+		}
+
+		void hdel( std::string_view key, std::string_view field, result_callback_t callback )
+		{
+			command( { "HDEL", key, field }, std::move( callback ) );
+		}
+
+		size_t size() const
+		{
+			return _callbacks.size();
+		}
+
+	public:
+		// Sends MULTI, the queued commands and EXEC in one write. Every queued callback receives its own
+		// element of the EXEC reply; when the transaction is aborted they receive the error instead.
+		void exec( result_callback_t callback = nullptr )
+		{
+			struct state_t
+			{
+				std::vector<result_callback_t> callbacks;
+				std::vector<redis::value> queued;
+			};
+
+			auto state = std::make_shared<state_t>();
+			state->callbacks = std::move( _callbacks );
+			state->queued.resize( state->callbacks.size() );
+
+			std::string cmds;
+			client::encode( cmds, { "MULTI" } );
+			cmds.append( _cmds );
+			client::encode( cmds, { "EXEC" } );
+
+			std::vector<result_callback_t> handlers;
+			handlers.reserve( state->callbacks.size() + 2 );
+
+			handlers.emplace_back( nullptr );
+			for ( size_t i = 0; i < state->callbacks.size(); ++i )
+			{
+				handlers.emplace_back( [state, i]( redis::value result ) { state->queued[i] = std::move( result ); } );
+			}
+			handlers.emplace_back( [state, callback = std::move( callback )]( redis::value result )
+			{
+				for ( size_t i = 0; i < state->callbacks.size(); ++i )
+				{
+					if ( state->callbacks[i] == nullptr )
+						continue;
+
+					if ( result.is_array() && i < result.get_array().size() )
+						state->callbacks[i]( result.get_array()[i] );
+					else if ( state->queued[i].is_error() )
+						state->callbacks[i]( state->queued[i] );
+					else if ( result.is_null() )
+						state->callbacks[i]( redis::value( redis::value::redis_reject_error, "EXECABORT Transaction discarded because a watched key was modified." ) );
+					else
+						state->callbacks[i]( result );
+				}
+
+				if ( callback )
+					callback( std::move( result ) );
+			} );
+
+			_cmds.clear();
+			_client.pipeline( cmds, std::move( handlers ) );
+		}
+
+		void discard()
+		{
+			_cmds.clear();
+			_callbacks.clear();
+		}
+
+	private:
+		redis::client & _client;
+		std::string _cmds;
+		std::vector<result_callback_t> _callbacks;
+	};
+
+	class coalescer
+	{
+		enum kind_t
+		{
+			Get,
+			HGet,
+			SIsMember,
+		};
+
+		using key_t = std::pair< kind_t, std::string >;
+		using batch_t = std::map< std::string, std::vector< client::result_callback_t > >;
+
+	public:
+		using result_callback_t = client::result_callback_t;
+
+	public:
+		// max_batch: distinct keys per command before the batch is sent on its own
+		// cluster: split MGET batches by hash slot so a batch never crosses slots
+		coalescer( redis::client & c, size_t max_batch = 128, bool cluster = false )
+			: _client( c ), _max_batch( max_batch ), _cluster( cluster )
+		{
+		}
+
+		~coalescer()
+		{
+			flush();
+		}
+
+	public:
+		void get( std::string_view key, result_callback_t callback )
+		{
+			add( Get, _cluster ? std::to_string( hash_slot( key ) ) : std::string(), key, std::move( callback ) );
+		}
+
+		void hget( std::string_view key, std::string_view field, result_callback_t callback )
+		{
+			add( HGet, std::string( key ), field, std::move( callback ) );
+		}
+
+		void sismember( std::string_view key, std::string_view member, result_callback_t callback )
+		{
+			add( SIsMember, std::string( key ), member, std::move( callback ) );
+		}
+
+	public:
+		// Sends everything collected so far in a single write; call it once per event loop tick
+		void flush()
+		{
+			std::map< key_t, batch_t > batches;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				batches.swap( _batches );
+			}
+
+			send( batches );
+		}
+
+	private:
+		void add( kind_t kind, std::string group, std::string_view key, result_callback_t callback )
+		{
+			std::map< key_t, batch_t > full;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				auto it = _batches.find( { kind, group } );
+				if ( it == _batches.end() )
+					it = _batches.insert( { { kind, std::move( group ) }, {} } ).first;
+
+				it->second[std::string( key )].emplace_back( std::move( callback ) );
+
+				if ( it->second.size() >= _max_batch )
+				{
+					full.insert( _batches.extract( it ) );
+				}
+			}
+
+			if ( !full.empty() )
+				send( full );
+		}
+
+		void send( std::map< key_t, batch_t > & batches )
+		{
+			std::string cmds;
+			std::vector< result_callback_t > handlers;
+
+			for ( auto & batch : batches )
+			{
+				kind_t kind = batch.first.first;
+				const std::string & group = batch.first.second;
+
+				std::vector< std::string_view > args;
+				args.reserve( batch.second.size() + 2 );
+
+				if ( batch.second.size() == 1 )
+				{
+					args.push_back( kind == Get ? "GET" : kind == HGet ? "HGET" : "SISMEMBER" );
+					if ( kind != Get )
+						args.push_back( group );
+					args.push_back( batch.second.begin()->first );
+
+					client::encode( cmds, args );
+					handlers.emplace_back( [callbacks = std::move( batch.second.begin()->second )]( redis::value result )
 					{
-						it->second( val.get_array()[2] );
+						for ( const auto & it : callbacks )
+							it( result );
+					} );
+					continue;
+				}
+
+				args.push_back( kind == Get ? "MGET" : kind == HGet ? "HMGET" : "SMISMEMBER" );
+				if ( kind != Get )
+					args.push_back( group );
+
+				std::vector< std::vector< result_callback_t > > callbacks;
+				callbacks.reserve( batch.second.size() );
+				for ( auto & it : batch.second )
+				{
+					args.push_back( it.first );
+					callbacks.emplace_back( std::move( it.second ) );
+				}
+
+				client::encode( cmds, args );
+				handlers.emplace_back( [callbacks = std::move( callbacks )]( redis::value result )
+				{
+					for ( size_t i = 0; i < callbacks.size(); ++i )
+					{
+						const redis::value & item = ( result.is_array() && i < result.get_array().size() ) ? result.get_array()[i] : result;
+
+						for ( const auto & it : callbacks[i] )
+							it( item );
+					}
+				} );
+			}
+
+			if ( !handlers.empty() )
+				_client.pipeline( cmds, std::move( handlers ) );
+		}
+
+	private:
+		redis::client & _client;
+		size_t _max_batch;
+		bool _cluster;
+		std::mutex _mutex;
+		std::map< key_t, batch_t > _batches;
+	};
+
+	class scanner : public std::enable_shared_from_this< scanner >
+	{
+	public:
+		// page is the element array of one reply (flat field/value pairs for HSCAN and ZSCAN), done is set on the last page
+		using page_callback_t = std::function< void( redis::value page, bool done ) >;
+
+	public:
+		// cmd is one of SCAN, SSCAN, HSCAN or ZSCAN; key is ignored by SCAN
+		scanner( redis::client & c, std::string_view cmd, std::string_view key = {}, scan_options options = {} )
+			: _client( c ), _cmd( cmd ), _key( key ), _options( std::move( options ) )
+		{
+		}
+
+	public:
+		bool done() const
+		{
+			std::unique_lock< std::mutex > lock( _mutex );
+			return _finished && !_has_page;
+		}
+
+		// Delivers the next page. The request for the page after it is sent before the callback runs,
+		// so one SCAN is always in flight while the caller consumes the current page.
+		void next( page_callback_t callback )
+		{
+			bool request = false, deliver = false, finished = false;
+			redis::value page;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				if ( _has_page )
+				{
+					page = std::move( _page );
+					_has_page = false;
+					deliver = true;
+					finished = _finished;
+				}
+				else if ( _finished )
+				{
+					deliver = true;
+					finished = true;
+				}
+				else
+				{
+					_waiting = std::move( callback );
+				}
+
+				if ( !_finished && !_inflight )
+				{
+					_inflight = true;
+					request = true;
+				}
+			}
+
+			if ( request )
+				send();
+
+			if ( deliver )
+				callback( std::move( page ), finished );
+		}
+
+		// Walks the whole cursor, calling on_page for every page and on_done once at the end
+		void each( std::function< void( redis::value ) > on_page, std::function< void() > on_done = nullptr )
+		{
+			auto self = shared_from_this();
+
+			next( [self, on_page = std::move( on_page ), on_done = std::move( on_done )]( redis::value page, bool done ) mutable
+			{
+				if ( page.is_array() || page.is_error() )
+					on_page( std::move( page ) );
+
+				if ( done )
+				{
+					if ( on_done )
+						on_done();
+				}
+				else
+				{
+					self->each( std::move( on_page ), std::move( on_done ) );
+				}
+			} );
+		}
+
+	private:
+		void send()
+		{
+			uint64_t cursor;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				cursor = _cursor;
+			}
+
+			_client.scan_command( _cmd, _key, cursor, _options, [self = shared_from_this()]( redis::value result ) { self->reply( std::move( result ) ); } );
+		}
+
+		void reply( redis::value result )
+		{
+			bool request = false;
+			page_callback_t callback;
+			redis::value page;
+			bool finished;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				_inflight = false;
+
+				uint64_t cursor = 0;
+				if ( result.is_array() && result.get_array().size() == 2 && result.get_array()[0].is_string() )
+				{
+					const std::string & str = result.get_array()[0].get_string();
+					std::from_chars( str.data(), str.data() + str.size(), cursor );
+					page = std::move( result.get_array()[1] );
+				}
+				else
+				{
+					page = std::move( result );
+				}
+
+				_cursor = cursor;
+				_finished = ( cursor == 0 );
+				finished = _finished;
+
+				if ( _waiting )
+				{
+					callback = std::move( _waiting );
+					_waiting = nullptr;
+
+					if ( !_finished )
+					{
+						_inflight = true;
+						request = true;
 					}
+				}
+				else
+				{
+					_page = std::move( page );
+					_has_page = true;
+				}
+			}
+
+			if ( request )
+				send();
+
+			if ( callback )
+				callback( std::move( page ), finished );
+		}
+
+	private:
+		redis::client & _client;
+		std::string _cmd;
+		std::string _key;
+		scan_options _options;
+
+		mutable std::mutex _mutex;
+		uint64_t _cursor = 0;
+		bool _inflight = false;
+		bool _finished = false;
+		bool _has_page = false;
+		redis::value _page;
+		page_callback_t _waiting;
+	};
 
+	// Runs several scanners at once, e.g. one per key or one per cluster node, each keeping its own page in flight
+	inline void parallel_scan( const std::vector< std::shared_ptr< scanner > > & scanners, std::function< void( size_t, redis::value ) > on_page, std::function< void() > on_done = nullptr )
+	{
+		if ( scanners.empty() )
+		{
+			if ( on_done )
+				on_done();
+			return;
+		}
+
+		auto remaining = std::make_shared< std::atomic< size_t > >( scanners.size() );
+		auto page = std::make_shared< std::function< void( size_t, redis::value ) > >( std::move( on_page ) );
+
+		for ( size_t i = 0; i < scanners.size(); ++i )
+		{
+			scanners[i]->each( [page, i]( redis::value result ) { ( *page )( i, std::move( result ) ); }, [remaining, on_done]()
+			{
+				if ( --*remaining == 0 && on_done )
+					on_done();
+			} );
+		}
+	}
+
+	struct stream_entry
+	{
+		std::string_view id;
+		std::vector< std::pair< std::string_view, std::string_view > > fields;
+	};
+
+	struct stream_options
+	{
+		size_t count = 100;           // entries per XREADGROUP
+		int block_ms = 1000;          // BLOCK timeout of XREADGROUP
+		size_t max_pending = 1000;    // entries handed out but not finished before reading pauses
+		size_t ack_batch = 64;        // ids per XACK
+		uint64_t min_idle_ms = 60000; // XAUTOCLAIM idle time
+	};
+
+	class stream_consumer : public std::enable_shared_from_this< stream_consumer >
+	{
+	public:
+		// Return true to acknowledge the entry
+		using entry_callback_t = std::function< bool( const stream_entry & ) >;
+		using error_callback_t = std::function< void( redis::value ) >;
+		using executor_t = std::function< void( std::function< void() > ) >;
+
+	public:
+		// reader is blocked by XREADGROUP and must be dedicated to this consumer, acks are sent through writer.
+		// executor runs the entry callbacks, e.g. by posting to a thread pool; entries run inline without one.
+		stream_consumer( redis::client & reader, redis::client & writer, std::string_view stream, std::string_view group, std::string_view consumer, entry_callback_t callback, stream_options opts = {}, executor_t executor = nullptr )
+			: _reader( reader ), _writer( writer ), _stream( stream ), _group( group ), _consumer( consumer ), _callback( std::move( callback ) ), _options( opts ), _executor( std::move( executor ) )
+		{
+			if ( _executor == nullptr )
+				_executor = []( std::function< void() > task ) { task(); };
+		}
+
+	public:
+		void on_error( error_callback_t callback )
+		{
+			_error = std::move( callback );
+		}
+
+		void start()
+		{
+			_stopped = false;
+			claim_stale();
+			read();
+		}
+
+		void stop()
+		{
+			_stopped = true;
+			flush_acks();
+		}
+
+		size_t pending() const
+		{
+			return _pending;
+		}
+
+		// Claims one page of entries idle for longer than min_idle_ms from other consumers; call it periodically
+		void claim_stale()
+		{
+			std::string start;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				start = _claim_start;
+			}
+
+			_writer.xautoclaim( _stream, _group, _consumer, _options.min_idle_ms, start, _options.count, [self = shared_from_this()]( redis::value result )
+			{
+				if ( result.is_error() )
+				{
+					self->error( std::move( result ) );
 					return;
 				}
-				else if ( cmd == "subscribe" )
+
+				if ( !result.is_array() || result.get_array().size() < 2 )
+					return;
+
 				{
+					std::unique_lock< std::mutex > lock( self->_mutex );
+					self->_claim_start = result.get_array()[0].to_string();
+				}
+
+				auto holder = std::make_shared< redis::value >( std::move( result ) );
+				self->dispatch( holder, holder->get_array()[1] );
+			} );
+		}
+
+		void flush_acks()
+		{
+			std::vector< std::string > ids;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				ids.swap( _acks );
+			}
+
+			if ( ids.empty() )
+				return;
+
+			std::vector< std::string_view > args{ "XACK", _stream, _group };
+			args.insert( args.end(), ids.begin(), ids.end() );
+			_writer.command( args, nullptr );
+		}
+
+	private:
+		void read()
+		{
+			size_t count;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				if ( _reading || _stopped || _pending >= _options.max_pending )
 					return;
+
+				_reading = true;
+				count = std::min( _options.count, _options.max_pending - _pending );
+			}
+
+			// acks collected while the previous batch was processed go out with every read
+			flush_acks();
+
+			_reader.xreadgroup( _group, _consumer, _stream, ">", count, _options.block_ms, [self = shared_from_this()]( redis::value result )
+			{
+				if ( result.is_error() )
+				{
+					self->error( std::move( result ) );
+				}
+				// nil on BLOCK timeout, otherwise [[stream, [entry...]]]
+				else if ( result.is_array() && !result.get_array().empty() && result.get_array()[0].is_array() && result.get_array()[0].get_array().size() == 2 )
+				{
+					auto holder = std::make_shared< redis::value >( std::move( result ) );
+					self->dispatch( holder, holder->get_array()[0].get_array()[1] );
+				}
+
+				{
+					std::unique_lock< std::mutex > lock( self->_mutex );
+					self->_reading = false;
+				}
+
+				self->read();
+			} );
+		}
+
+		void dispatch( const std::shared_ptr< redis::value > & holder, const redis::value & entries )
+		{
+			if ( !entries.is_array() )
+				return;
+
+			for ( const auto & item : entries.get_array() )
+			{
+				if ( !item.is_array() || item.get_array().size() != 2 || !item.get_array()[0].is_string() )
+					continue;
+
+				stream_entry entry;
+				entry.id = item.get_array()[0].get_string();
+
+				const auto & fields = item.get_array()[1];
+				if ( fields.is_array() )
+				{
+					const auto & arr = fields.get_array();
+					entry.fields.reserve( arr.size() / 2 );
+					for ( size_t i = 0; i + 1 < arr.size(); i += 2 )
+					{
+						if ( arr[i].is_string() && arr[i + 1].is_string() )
+							entry.fields.emplace_back( arr[i].get_string(), arr[i + 1].get_string() );
+					}
 				}
+
+				++_pending;
+				_executor( [self = shared_from_this(), holder, entry = std::move( entry )]()
+				{
+					self->done( entry.id, self->_callback( entry ) );
+				} );
 			}
+		}
 
-			std::unique_lock< std::mutex > lock( _wmutex );
+		void done( std::string_view id, bool ack )
+		{
+			bool flush = false, resume = false;
 			{
-				auto handler = std::move( _handler.front() );
-				_handler.pop_front();
-				handler( val );
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				if ( ack )
+					_acks.emplace_back( id );
+
+				flush = _acks.size() >= _options.ack_batch;
+				resume = --_pending <= _options.max_pending / 2 && !_reading;
+			}
+
+			if ( flush )
+				flush_acks();
+
+			if ( resume )
+				read();
+		}
+
+		void error( redis::value result )
+		{
+			_stopped = true;
+
+			if ( _error )
+				_error( std::move( result ) );
+		}
+
+	private:
+		redis::client & _reader;
+		redis::client & _writer;
+		std::string _stream;
+		std::string _group;
+		std::string _consumer;
+		entry_callback_t _callback;
+		error_callback_t _error;
+		stream_options _options;
+		executor_t _executor;
+
+		std::mutex _mutex;
+		bool _reading = false;
+		std::atomic< bool > _stopped = false;
+		std::atomic< size_t > _pending = 0;
+		std::string _claim_start = "0-0";
+		std::vector< std::string > _acks;
+	};
+
+	class stream_producer
+	{
+	public:
+		using result_callback_t = client::result_callback_t;
+
+	public:
+		// maxlen trims the stream approximately (MAXLEN ~) when not zero
+		stream_producer( redis::client & c, std::string_view stream, size_t batch = 64, size_t maxlen = 0 )
+			: _client( c ), _stream( stream ), _batch( batch ), _maxlen( maxlen ? std::to_string( maxlen ) : std::string() )
+		{
+		}
+
+		~stream_producer()
+		{
+			flush();
+		}
+
+	public:
+		void add( const std::vector< std::pair< std::string_view, std::string_view > > & fields, result_callback_t callback = nullptr )
+		{
+			std::vector< std::string_view > args{ "XADD", _stream };
+			if ( !_maxlen.empty() )
+				args.insert( args.end(), { "MAXLEN", "~", _maxlen } );
+			args.push_back( "*" );
+			for ( const auto & it : fields )
+				args.insert( args.end(), { it.first, it.second } );
+
+			bool full;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				client::encode( _cmds, args );
+				_callbacks.emplace_back( std::move( callback ) );
+				full = _callbacks.size() >= _batch;
+			}
+
+			if ( full )
+				flush();
+		}
+
+		// Pipelines every queued XADD in one write
+		void flush()
+		{
+			std::string cmds;
+			std::vector< result_callback_t > callbacks;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				cmds.swap( _cmds );
+				callbacks.swap( _callbacks );
 			}
+
+			if ( !callbacks.empty() )
+				_client.pipeline( cmds, std::move( callbacks ) );
 		}
 
 	private:
-		redis::parser _parser;
-		output_callback_t _output;
-		std::mutex _rmutex, _wmutex;
-		std::deque<result_callback_t> _handler;
-		std::map<std::string, result_callback_t> _subscribe_handler;
+		redis::client & _client;
+		std::string _stream;
+		size_t _batch;
+		std::string _maxlen;
+		std::mutex _mutex;
+		std::string _cmds;
+		std::vector< result_callback_t > _callbacks;
 	};
 }
 
@@ -0,0 +1,419 @@
+/*!
+ * \file	redis_codec.hpp
+ *
+ * \author	redis_client contributors
+ * \date	2026/10/18
+ *
+ * Value codecs for redis::client: values above a size threshold are stored compressed behind a small header,
+ * and values without the header still read back unchanged. Ships a dependency-free LZ77 compressor that
+ * uses the LZ4 block layout.
+ */
+#ifndef REDIS_CODEC_HPP__5E0B7D14_A2C9_4F63_8B1D_93E4C6F02A7B
+#define REDIS_CODEC_HPP__5E0B7D14_A2C9_4F63_8B1D_93E4C6F02A7B
+
+#include "redis_client.hpp"
+
+namespace redis
+{
+	class compressor
+	{
+	public:
+		virtual ~compressor() = default;
+
+	public:
+		// Stored in the value header, 0 is reserved for uncompressed values
+		virtual uint8_t id() const = 0;
+
+		// Appends the compressed form of in to out
+		virtual void compress( std::string_view in, std::string & out ) const = 0;
+
+		// Decompresses exactly size bytes into out, false when in is malformed
+		virtual bool decompress( std::string_view in, char * out, size_t size ) const = 0;
+
+		// The largest size a payload of the given size can decompress to, which bounds what a header may claim
+		virtual size_t max_decompressed( size_t size ) const = 0;
+	};
+
+	// LZ77 with a single-probe hash table, emitting LZ4 block sequences: a token with 4-bit literal and match
+	// lengths, the literals, a 16-bit offset and length extension bytes
+	class lz_compressor : public compressor
+	{
+		static constexpr size_t min_match = 4;
+		static constexpr size_t last_literals = 5;
+		static constexpr size_t match_limit = 12;
+		static constexpr size_t hash_bits = 12;
+		static constexpr size_t max_offset = 65535;
+
+	public:
+		uint8_t id() const override
+		{
+			return 1;
+		}
+
+		void compress( std::string_view in, std::string & out ) const override
+		{
+			const uint8_t * src = reinterpret_cast<const uint8_t *>( in.data() );
+			size_t size = in.size(), start = out.size();
+
+			// worst case is every byte a literal plus one length byte per 255 of them
+			out.resize( start + size + size / 255 + 16 );
+			uint8_t * dst = reinterpret_cast<uint8_t *>( &out[start] ), * op = dst;
+
+			uint32_t table[1 << hash_bits] = {};
+			size_t ip = 0, anchor = 0;
+
+			if ( size > match_limit )
+			{
+				for ( size_t limit = size - match_limit; ip < limit; )
+				{
+					uint32_t seq = read32( src + ip );
+					uint32_t & slot = table[( seq * 2654435761u ) >> ( 32 - hash_bits )];
+					size_t ref = slot;
+					slot = uint32_t( ip );
+
+					if ( ref >= ip || ip - ref > max_offset || read32( src + ref ) != seq )
+					{
+						// skip faster through data that does not compress
+						ip += 1 + ( ( ip - anchor ) >> 6 );
+						continue;
+					}
+
+					size_t len = min_match, end = size - last_literals;
+					while ( ip + len < end && src[ref + len] == src[ip + len] )
+						++len;
+
+					op = sequence( op, src + anchor, ip - anchor, ip - ref, len );
+
+					ip += len;
+					anchor = ip;
+				}
+			}
+
+			op = sequence( op, src + anchor, size - anchor, 0, 0 );
+
+			out.resize( start + ( op - dst ) );
+		}
+
+		bool decompress( std::string_view in, char * out, size_t size ) const override
+		{
+			const uint8_t * ip = reinterpret_cast<const uint8_t *>( in.data() ), * iend = ip + in.size();
+			char * op = out, * oend = out + size;
+
+			while ( ip < iend )
+			{
+				uint8_t token = *ip++;
+
+				size_t literals = token >> 4;
+				if ( literals == 15 && !length( ip, iend, literals ) )
+					return false;
+				if ( size_t( iend - ip ) < literals || size_t( oend - op ) < literals )
+					return false;
+
+				std::memcpy( op, ip, literals );
+				ip += literals;
+				op += literals;
+
+				// the last sequence has no match
+				if ( ip == iend )
+					break;
+
+				if ( iend - ip < 2 )
+					return false;
+				size_t offset = ip[0] | ( size_t( ip[1] ) << 8 );
+				ip += 2;
+
+				size_t len = token & 15;
+				if ( len == 15 && !length( ip, iend, len ) )
+					return false;
+				len += min_match;
+
+				if ( offset == 0 || offset > size_t( op - out ) || size_t( oend - op ) < len )
+					return false;
+
+				const char * ref = op - offset;
+				if ( offset >= len )
+				{
+					std::memcpy( op, ref, len );
+					op += len;
+				}
+				else
+				{
+					// overlapping copies repeat the last offset bytes
+					for ( size_t i = 0; i < len; ++i )
+						*op++ = ref[i];
+				}
+			}
+
+			return op == oend;
+		}
+
+		size_t max_decompressed( size_t size ) const override
+		{
+			// every length extension byte adds at most 255 bytes of match
+			return size * 255 + 16;
+		}
+
+	private:
+		static uint32_t read32( const uint8_t * p )
+		{
+			uint32_t v;
+			std::memcpy( &v, p, sizeof( v ) );
+			return v;
+		}
+
+		static uint8_t * sequence( uint8_t * op, const uint8_t * literals, size_t count, size_t offset, size_t len )
+		{
+			uint8_t * token = op++;
+			*token = uint8_t( std::min<size_t>( count, 15 ) << 4 );
+			if ( count >= 15 )
+				op = extend( op, count - 15 );
+
+			std::memcpy( op, literals, count );
+			op += count;
+
+			if ( len != 0 )
+			{
+				*op++ = uint8_t( offset );
+				*op++ = uint8_t( offset >> 8 );
+
+				len -= min_match;
+				*token |= uint8_t( std::min<size_t>( len, 15 ) );
+				if ( len >= 15 )
+					op = extend( op, len - 15 );
+			}
+
+			return op;
+		}
+
+		static uint8_t * extend( uint8_t * op, size_t len )
+		{
+			for ( ; len >= 255; len -= 255 )
+				*op++ = 255;
+			*op++ = uint8_t( len );
+			return op;
+		}
+
+		static bool length( const uint8_t *& ip, const uint8_t * iend, size_t & len )
+		{
+			uint8_t b;
+			do
+			{
+				if ( ip == iend )
+					return false;
+				b = *ip++;
+				len += b;
+			} while ( b == 255 );
+			return true;
+		}
+	};
+
+	struct codec_options
+	{
+		size_t threshold = 1024;                   // values shorter than this are stored as they are
+		std::shared_ptr< const redis::compressor > compressor = std::make_shared< lz_compressor >();
+	};
+
+	// Stored values are either plain bytes, or a header byte, the compressor id, the original size as a varint
+	// and the payload. A plain value that happens to start with the header byte is escaped with id 0. Anything
+	// whose header does not parse or claims an impossible size is returned as it is, so values written without
+	// a codec keep reading back unchanged; a header that parses but whose payload fails to decompress is corrupt.
+	class value_codec
+	{
+	public:
+		static constexpr uint8_t header = 0xC7;
+
+	public:
+		value_codec( codec_options options = {} )
+			: _options( std::move( options ) )
+		{
+			_compressors[1] = std::make_shared< lz_compressor >();
+			if ( _options.compressor )
+				_compressors[_options.compressor->id()] = _options.compressor;
+		}
+
+	public:
+		// Makes another compressor readable, e.g. one that was used before switching codecs
+		void add( std::shared_ptr< const compressor > compressor )
+		{
+			_compressors[compressor->id()] = std::move( compressor );
+		}
+
+		void encode( std::string_view value, std::string & out ) const
+		{
+			out.clear();
+
+			if ( _options.compressor && value.size() >= _options.threshold )
+			{
+				prefix( out, _options.compressor->id(), value.size() );
+				_options.compressor->compress( value, out );
+
+				// keep the raw bytes when compression does not pay
+				if ( out.size() < value.size() )
+					return;
+
+				out.clear();
+			}
+
+			if ( !value.empty() && uint8_t( value[0] ) == header )
+				prefix( out, 0, value.size() );
+
+			out.append( value );
+		}
+
+		// Size the value decodes to, or the stored size when the header does not parse
+		size_t decoded_size( std::string_view stored ) const
+		{
+			uint8_t id = 0;
+			size_t size = 0, offset = 0;
+			parse( stored, id, size, offset );
+			return size;
+		}
+
+		// Decodes straight into out and returns the decoded size, or npos when capacity is below decoded_size()
+		// or the payload is corrupt
+		size_t decode( std::string_view stored, char * out, size_t capacity ) const
+		{
+			uint8_t id = 0;
+			size_t size = 0, offset = 0;
+			parse( stored, id, size, offset );
+
+			if ( capacity < size )
+				return std::string_view::npos;
+
+			if ( id == 0 )
+				std::memcpy( out, stored.data() + offset, size );
+			else if ( !_compressors[id]->decompress( stored.substr( offset ), out, size ) )
+				return std::string_view::npos;
+
+			return size;
+		}
+
+		// False when the payload is corrupt, out is left empty then
+		bool decode( std::string_view stored, std::string & out ) const
+		{
+			out.resize( decoded_size( stored ) );
+
+			if ( decode( stored, out.data(), out.size() ) == std::string_view::npos )
+			{
+				out.clear();
+				return false;
+			}
+
+			return true;
+		}
+
+	private:
+		// Falls back to the plain bytes whenever the header is not one this codec wrote
+		void parse( std::string_view stored, uint8_t & id, size_t & size, size_t & offset ) const
+		{
+			id = 0;
+			size = stored.size();
+			offset = 0;
+
+			if ( stored.size() < 3 || uint8_t( stored[0] ) != header )
+				return;
+
+			uint8_t kind = uint8_t( stored[1] );
+			if ( kind != 0 && !_compressors[kind] )
+				return;
+
+			size_t claimed = 0, pos = 2;
+			for ( int shift = 0; ; shift += 7 )
+			{
+				if ( pos == stored.size() || shift > 56 )
+					return;
+
+				uint8_t b = uint8_t( stored[pos++] );
+				claimed |= size_t( b & 0x7F ) << shift;
+				if ( ( b & 0x80 ) == 0 )
+					break;
+			}
+
+			size_t payload = stored.size() - pos;
+			if ( kind == 0 ? claimed != payload : claimed > _compressors[kind]->max_decompressed( payload ) )
+				return;
+
+			id = kind;
+			size = claimed;
+			offset = pos;
+		}
+
+		static void prefix( std::string & out, uint8_t id, size_t size )
+		{
+			out.push_back( char( header ) );
+			out.push_back( char( id ) );
+			for ( ; size >= 0x80; size >>= 7 )
+				out.push_back( char( ( size & 0x7F ) | 0x80 ) );
+			out.push_back( char( size ) );
+		}
+
+	private:
+		codec_options _options;
+		std::array< std::shared_ptr< const compressor >, 256 > _compressors;
+	};
+
+	// Typed string commands that encode values on the way out and decode replies on the way in
+	class codec_client
+	{
+	public:
+		using result_callback_t = client::result_callback_t;
+
+	public:
+		codec_client( redis::client & client, codec_options options = {} )
+			: _client( client ), _codec( std::move( options ) )
+		{
+		}
+
+	public:
+		const value_codec & codec() const
+		{
+			return _codec;
+		}
+
+		void set( std::string_view key, std::string_view value, result_callback_t callback )
+		{
+			std::string stored;
+			_codec.encode( value, stored );
+			_client.set( key, stored, std::move( callback ) );
+		}
+
+		// The reply string is replaced by the decoded value
+		void get( std::string_view key, result_callback_t callback )
+		{
+			_client.get( key, [this, callback = std::move( callback )]( redis::value result )
+			{
+				if ( !callback )
+					return;
+
+				if ( !result.is_ok() || !result.is_string() )
+					return callback( std::move( result ) );
+
+				std::string value;
+				if ( !_codec.decode( result.get_string(), value ) )
+					return callback( redis::value( redis::value::redis_parse_error, "value cannot be decoded" ) );
+
+				callback( redis::value( std::move( value ) ) );
+			} );
+		}
+
+		// Decodes straight from the reply bytes into out, which must stay alive until the callback runs; the
+		// callback gets the reply with its string left as stored, or an error when the value is corrupt
+		void get( std::string_view key, std::string & out, result_callback_t callback )
+		{
+			_client.get( key, [this, &out, callback = std::move( callback )]( redis::value result )
+			{
+				if ( result.is_ok() && result.is_string() && !_codec.decode( result.get_string(), out ) )
+					result = redis::value( redis::value::redis_parse_error, "value cannot be decoded" );
+
+				if ( callback )
+					callback( std::move( result ) );
+			} );
+		}
+
+	private:
+		redis::client & _client;
+		value_codec _codec;
+	};
+}
+
+#endif//REDIS_CODEC_HPP__5E0B7D14_A2C9_4F63_8B1D_93E4C6F02A7B
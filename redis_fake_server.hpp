@@ -0,0 +1,280 @@
+/*!
+ * \file	redis_fake_server.hpp
+ *
+ * \author	redis_client contributors
+ * \date	2026/10/18
+ *
+ * In-process RESP server stand-in for benchmarks and load generation (POSIX sockets).
+ * Supports PING, ECHO, AUTH, SELECT, GET, SET, DEL, HSET, HGET, SADD, SISMEMBER and PUBLISH.
+ */
+#ifndef REDIS_FAKE_SERVER_HPP__3B1E8C52_6F0D_4A8B_9C43_7E2D5A1F6B90
+#define REDIS_FAKE_SERVER_HPP__3B1E8C52_6F0D_4A8B_9C43_7E2D5A1F6B90
+
+#include <thread>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "redis_client.hpp"
+
+namespace redis
+{
+	class fake_server
+	{
+	public:
+		// port 0 binds an ephemeral port on 127.0.0.1, see port()
+		fake_server( uint16_t port = 0 )
+		{
+			_listen = ::socket( AF_INET, SOCK_STREAM, 0 );
+
+			int on = 1;
+			::setsockopt( _listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+
+			sockaddr_in addr = {};
+			addr.sin_family = AF_INET;
+			addr.sin_port = htons( port );
+			addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+			if ( ::bind( _listen, reinterpret_cast<sockaddr *>( &addr ), sizeof( addr ) ) != 0 || ::listen( _listen, 128 ) != 0 )
+			{
+				::close( _listen );
+				throw std::runtime_error( "fake_server: bind failed" );
+			}
+
+			socklen_t len = sizeof( addr );
+			::getsockname( _listen, reinterpret_cast<sockaddr *>( &addr ), &len );
+			_port = ntohs( addr.sin_port );
+
+			_acceptor = std::thread( [this]() { accept_loop(); } );
+		}
+
+		~fake_server()
+		{
+			stop();
+		}
+
+	public:
+		uint16_t port() const
+		{
+			return _port;
+		}
+
+		// Serves an already connected socket, e.g. one end of a socketpair
+		void serve( int fd )
+		{
+			std::unique_lock< std::mutex > lock( _mutex );
+
+			_fds.push_back( fd );
+			_sessions.emplace_back( [this, fd]() { session( fd ); } );
+		}
+
+		void stop()
+		{
+			if ( _stopped.exchange( true ) )
+				return;
+
+			::shutdown( _listen, SHUT_RDWR );
+			::close( _listen );
+			if ( _acceptor.joinable() )
+				_acceptor.join();
+
+			std::vector< std::thread > sessions;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+
+				for ( int fd : _fds )
+					::shutdown( fd, SHUT_RDWR );
+
+				sessions.swap( _sessions );
+			}
+
+			for ( auto & it : sessions )
+				it.join();
+		}
+
+	private:
+		void accept_loop()
+		{
+			while ( !_stopped )
+			{
+				int fd = ::accept( _listen, nullptr, nullptr );
+				if ( fd < 0 )
+					break;
+
+				int on = 1;
+				::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+
+				serve( fd );
+			}
+		}
+
+		void session( int fd )
+		{
+			redis::parser parser;
+			std::string buf( 64 * 1024, 0 ), out;
+
+			while ( true )
+			{
+				ssize_t n = ::read( fd, buf.data(), buf.size() );
+				if ( n <= 0 )
+					break;
+
+				auto cur = buf.begin(), end = buf.begin() + n;
+				while ( cur != end )
+				{
+					auto result = parser.parse( cur, end );
+					cur += result.first;
+
+					if ( result.second == redis::parser::Completed )
+						execute( parser.result(), out );
+					else if ( result.second == redis::parser::Error )
+						out.append( "-ERR protocol error\r\n" );
+				}
+
+				// every reply produced by one read goes out in one write
+				for ( size_t off = 0; off < out.size(); )
+				{
+					ssize_t w = ::write( fd, out.data() + off, out.size() - off );
+					if ( w <= 0 )
+						break;
+					off += w;
+				}
+				out.clear();
+			}
+
+			std::unique_lock< std::mutex > lock( _mutex );
+
+			_fds.erase( std::find( _fds.begin(), _fds.end(), fd ) );
+			::close( fd );
+		}
+
+		void execute( const redis::value & cmd, std::string & out )
+		{
+			if ( !cmd.is_array() || cmd.get_array().empty() )
+			{
+				out.append( "-ERR invalid command\r\n" );
+				return;
+			}
+
+			const auto & args = cmd.get_array();
+			std::string name = args[0].to_string();
+			for ( auto & c : name )
+				c = toupper( c );
+
+			auto arg = [&]( size_t i ) -> const std::string & { return args[i].get_string(); };
+
+			std::unique_lock< std::mutex > lock( _data_mutex );
+
+			if ( name == "PING" )
+			{
+				out.append( "+PONG\r\n" );
+			}
+			else if ( ( name == "AUTH" || name == "SELECT" ) && args.size() >= 2 )
+			{
+				out.append( "+OK\r\n" );
+			}
+			else if ( name == "ECHO" && args.size() == 2 )
+			{
+				bulk( out, arg( 1 ) );
+			}
+			else if ( name == "SET" && args.size() >= 3 )
+			{
+				_strings[arg( 1 )] = arg( 2 );
+				out.append( "+OK\r\n" );
+			}
+			else if ( name == "GET" && args.size() == 2 )
+			{
+				auto it = _strings.find( arg( 1 ) );
+				if ( it == _strings.end() )
+					out.append( "$-1\r\n" );
+				else
+					bulk( out, it->second );
+			}
+			else if ( name == "DEL" && args.size() >= 2 )
+			{
+				int64_t count = 0;
+				for ( size_t i = 1; i < args.size(); ++i )
+					count += _strings.erase( arg( i ) ) + _hashes.erase( arg( i ) ) + _sets.erase( arg( i ) );
+				integer( out, count );
+			}
+			else if ( name == "HSET" && args.size() >= 4 && args.size() % 2 == 0 )
+			{
+				int64_t count = 0;
+				auto & hash = _hashes[arg( 1 )];
+				for ( size_t i = 2; i + 1 < args.size(); i += 2 )
+					count += hash.insert_or_assign( arg( i ), arg( i + 1 ) ).second;
+				integer( out, count );
+			}
+			else if ( name == "HGET" && args.size() == 3 )
+			{
+				const std::string * field = nullptr;
+
+				auto it = _hashes.find( arg( 1 ) );
+				if ( it != _hashes.end() )
+				{
+					auto f = it->second.find( arg( 2 ) );
+					if ( f != it->second.end() )
+						field = &f->second;
+				}
+
+				if ( field == nullptr )
+					out.append( "$-1\r\n" );
+				else
+					bulk( out, *field );
+			}
+			else if ( name == "SADD" && args.size() >= 3 )
+			{
+				int64_t count = 0;
+				auto & set = _sets[arg( 1 )];
+				for ( size_t i = 2; i < args.size(); ++i )
+					count += set.insert( arg( i ) ).second;
+				integer( out, count );
+			}
+			else if ( name == "SISMEMBER" && args.size() == 3 )
+			{
+				auto it = _sets.find( arg( 1 ) );
+				integer( out, it != _sets.end() && it->second.count( arg( 2 ) ) );
+			}
+			else if ( name == "PUBLISH" && args.size() == 3 )
+			{
+				integer( out, 0 );
+			}
+			else
+			{
+				out.append( "-ERR unknown command '" ).append( name ).append( "'\r\n" );
+			}
+		}
+
+		static void bulk( std::string & out, const std::string & str )
+		{
+			out.append( "$" ).append( std::to_string( str.size() ) ).append( CRCF ).append( str ).append( CRCF );
+		}
+
+		static void integer( std::string & out, int64_t i )
+		{
+			out.append( ":" ).append( std::to_string( i ) ).append( CRCF );
+		}
+
+	private:
+		int _listen = -1;
+		uint16_t _port = 0;
+		std::atomic< bool > _stopped = false;
+		std::thread _acceptor;
+
+		std::mutex _mutex;
+		std::vector< int > _fds;
+		std::vector< std::thread > _sessions;
+
+		std::mutex _data_mutex;
+		std::unordered_map< std::string, std::string > _strings;
+		std::unordered_map< std::string, std::unordered_map< std::string, std::string > > _hashes;
+		std::unordered_map< std::string, std::unordered_set< std::string > > _sets;
+	};
+}
+
+#endif//REDIS_FAKE_SERVER_HPP__3B1E8C52_6F0D_4A8B_9C43_7E2D5A1F6B90
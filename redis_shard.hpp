@@ -0,0 +1,235 @@
+/*!
+ * \file	redis_shard.hpp
+ *
+ * \author	redis_client contributors
+ * \date	2026/10/18
+ *
+ * Shard-per-core runtime on top of redis::uring_loop (Linux). Every shard is one pinned thread with its
+ * own ring, connections and clients, so no redis::client is ever shared between threads. Commands are
+ * routed to a shard by the key's hash slot and cross threads only through lock-free task queues.
+ */
+#ifndef REDIS_SHARD_HPP__71D3A9E6_0B4C_4E28_95F7_C8A2E61D3B5F
+#define REDIS_SHARD_HPP__71D3A9E6_0B4C_4E28_95F7_C8A2E61D3B5F
+
+#include <future>
+
+#include <pthread.h>
+
+#include "redis_uring.hpp"
+
+namespace redis
+{
+	struct shard_options
+	{
+		size_t shards = 0;                // 0 uses one shard per hardware thread
+		size_t connections_per_shard = 1;
+		std::string host = "127.0.0.1";
+		std::string port = "6379";
+		bool pin_threads = true;          // pin shard i to cpu i
+		uring_options uring;
+	};
+
+	class shard_runtime
+	{
+	public:
+		using result_callback_t = client::result_callback_t;
+
+		struct shard_t
+		{
+			size_t index = 0;
+			std::unique_ptr< uring_loop > loop;
+			std::vector< redis::client * > clients;
+			std::thread thread;
+		};
+
+	public:
+		shard_runtime( shard_options options )
+			: _options( std::move( options ) )
+		{
+			if ( _options.shards == 0 )
+				_options.shards = std::max( 1u, std::thread::hardware_concurrency() );
+
+			_options.uring.max_connections = std::max( _options.uring.max_connections, _options.connections_per_shard );
+
+			std::vector< std::future< void > > ready;
+
+			for ( size_t i = 0; i < _options.shards; ++i )
+			{
+				auto shard = std::make_unique< shard_t >();
+				shard->index = i;
+
+				auto promise = std::make_shared< std::promise< void > >();
+				ready.push_back( promise->get_future() );
+
+				shard_t * ptr = shard.get();
+				shard->thread = std::thread( [this, ptr, promise]() { run( *ptr, *promise ); } );
+
+				_shards.push_back( std::move( shard ) );
+			}
+
+			// rethrows a failed connect or ring setup once every shard has settled
+			std::exception_ptr error;
+			for ( auto & it : ready )
+			{
+				try
+				{
+					it.get();
+				}
+				catch ( ... )
+				{
+					error = std::current_exception();
+				}
+			}
+
+			if ( error )
+			{
+				shutdown();
+				std::rethrow_exception( error );
+			}
+		}
+
+		~shard_runtime()
+		{
+			shutdown();
+		}
+
+	public:
+		size_t shards() const
+		{
+			return _shards.size();
+		}
+
+		// The same key always maps to the same shard and connection, which keeps per-key ordering
+		size_t shard_of( std::string_view key ) const
+		{
+			return hash_slot( key ) % _shards.size();
+		}
+
+		// The shard running the calling thread, or nullptr outside the runtime
+		static shard_t * current()
+		{
+			return current_shard();
+		}
+
+		// Runs task on shard index with one of its clients
+		void post( size_t index, std::function< void( redis::client & ) > task )
+		{
+			shard_t & shard = *_shards[index];
+			shard.loop->post( [&shard, task = std::move( task )]() { task( *shard.clients.front() ); } );
+		}
+
+		// Encodes on the calling thread and sends from the key's shard. A caller running on a shard gets its
+		// callback back on that shard; any other caller gets it on the key's shard.
+		void command( std::string_view key, const std::vector< std::string_view > & args, result_callback_t callback )
+		{
+			std::string cmd;
+			client::encode( cmd, args );
+
+			uint16_t slot = hash_slot( key );
+			shard_t & target = *_shards[slot % _shards.size()];
+			shard_t * origin = current_shard();
+
+			if ( origin != nullptr && origin != &target && callback )
+			{
+				uring_loop * loop = origin->loop.get();
+				callback = [loop, callback = std::move( callback )]( redis::value result ) mutable
+				{
+					loop->post( [callback = std::move( callback ), result = std::move( result )]() mutable { callback( std::move( result ) ); } );
+				};
+			}
+
+			auto send = [this, &target, slot, cmd = std::move( cmd ), callback = std::move( callback )]() mutable
+			{
+				redis::client & c = *target.clients[( slot / _shards.size() ) % target.clients.size()];
+				c.pipeline( cmd, { std::move( callback ) } );
+			};
+
+			if ( origin == &target )
+				send();
+			else
+				target.loop->post( std::move( send ) );
+		}
+
+	public:
+		void get( std::string_view key, result_callback_t callback )
+		{
+			command( key, { "GET", key }, std::move( callback ) );
+		}
+
+		void set( std::string_view key, std::string_view value, result_callback_t callback )
+		{
+			command( key, { "SET", key, value }, std::move( callback ) );
+		}
+
+		void del( std::string_view key, result_callback_t callback )
+		{
+			command( key, { "DEL", key }, std::move( callback ) );
+		}
+
+		void hget( std::string_view key, std::string_view field, result_callback_t callback )
+		{
+			command( key, { "HGET", key, field }, std::move( callback ) );
+		}
+
+		void hset( std::string_view key, std::string_view field, std::string_view value, result_callback_t callback )
+		{
+			command( key, { "HSET", key, field, value }, std::move( callback ) );
+		}
+
+	private:
+		static shard_t *& current_shard()
+		{
+			static thread_local shard_t * shard = nullptr;
+			return shard;
+		}
+
+		void shutdown()
+		{
+			for ( auto & it : _shards )
+			{
+				if ( it->loop )
+					it->loop->stop();
+			}
+
+			for ( auto & it : _shards )
+			{
+				if ( it->thread.joinable() )
+					it->thread.join();
+			}
+		}
+
+		void run( shard_t & shard, std::promise< void > & ready )
+		{
+			try
+			{
+				if ( _options.pin_threads )
+				{
+					cpu_set_t set;
+					CPU_ZERO( &set );
+					CPU_SET( shard.index % std::max( 1u, std::thread::hardware_concurrency() ), &set );
+					::pthread_setaffinity_np( ::pthread_self(), sizeof( set ), &set );
+				}
+
+				shard.loop = std::make_unique< uring_loop >( _options.uring );
+				for ( size_t i = 0; i < _options.connections_per_shard; ++i )
+					shard.clients.push_back( &shard.loop->connect( _options.host, _options.port ) );
+			}
+			catch ( ... )
+			{
+				ready.set_exception( std::current_exception() );
+				return;
+			}
+
+			current_shard() = &shard;
+			ready.set_value();
+
+			shard.loop->run();
+		}
+
+	private:
+		shard_options _options;
+		std::vector< std::unique_ptr< shard_t > > _shards;
+	};
+}
+
+#endif//REDIS_SHARD_HPP__71D3A9E6_0B4C_4E28_95F7_C8A2E61D3B5F
@@ -0,0 +1,784 @@
+/*!
+ * \file	redis_uring.hpp
+ *
+ * \author	redis_client contributors
+ * \date	2026/10/18
+ *
+ * Optional Linux io_uring transport for redis::client, talking to the kernel directly (no liburing).
+ * One uring_loop drives many connections from one thread: reads use multishot recv into a provided
+ * buffer ring, writes go out of per connection registered buffers, and every loop iteration submits
+ * the work of all connections with a single io_uring_enter.
+ */
+#ifndef REDIS_URING_HPP__E5B7D0A4_2C91_4F36_8D5B_61A9F3C7E204
+#define REDIS_URING_HPP__E5B7D0A4_2C91_4F36_8D5B_61A9F3C7E204
+
+#include <thread>
+#include <system_error>
+
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/io_uring.h>
+
+#include "redis_client.hpp"
+
+namespace redis
+{
+	struct uring_options
+	{
+		unsigned entries = 256;           // submission queue size
+		bool sqpoll = false;              // let a kernel thread poll the submission queue
+		unsigned sqpoll_idle_ms = 1000;
+		size_t max_connections = 64;
+		size_t write_buffer = 64 * 1024;  // registered send buffer per connection, larger batches spill into a linked send
+		unsigned read_buffers = 256;      // provided buffer ring entries, a power of two
+		size_t read_buffer_size = 16 * 1024;
+		size_t task_queue = 4096;         // post() capacity, a power of two
+	};
+
+	// Bounded lock-free queue for many producers and one consumer (Vyukov), push spins while full
+	template< typename T > class mpsc_queue
+	{
+		struct cell_t
+		{
+			std::atomic< size_t > sequence;
+			T data;
+		};
+
+	public:
+		mpsc_queue( size_t capacity = 4096 )
+			: _cells( capacity ), _mask( capacity - 1 )
+		{
+			for ( size_t i = 0; i < capacity; ++i )
+				_cells[i].sequence.store( i, std::memory_order_relaxed );
+		}
+
+	public:
+		bool try_push( T && value )
+		{
+			size_t pos = _tail.load( std::memory_order_relaxed );
+
+			while ( true )
+			{
+				cell_t & cell = _cells[pos & _mask];
+				intptr_t diff = intptr_t( cell.sequence.load( std::memory_order_acquire ) ) - intptr_t( pos );
+
+				if ( diff == 0 )
+				{
+					if ( _tail.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+					{
+						cell.data = std::move( value );
+						cell.sequence.store( pos + 1, std::memory_order_release );
+						return true;
+					}
+				}
+				else if ( diff < 0 )
+				{
+					return false;
+				}
+				else
+				{
+					pos = _tail.load( std::memory_order_relaxed );
+				}
+			}
+		}
+
+		void push( T value )
+		{
+			while ( !try_push( std::move( value ) ) )
+				std::this_thread::yield();
+		}
+
+		bool pop( T & value )
+		{
+			cell_t & cell = _cells[_head & _mask];
+
+			if ( intptr_t( cell.sequence.load( std::memory_order_acquire ) ) - intptr_t( _head + 1 ) < 0 )
+				return false;
+
+			value = std::move( cell.data );
+			cell.sequence.store( _head + _mask + 1, std::memory_order_release );
+			++_head;
+
+			return true;
+		}
+
+	private:
+		std::vector< cell_t > _cells;
+		size_t _mask;
+		size_t _head = 0;
+		alignas( 64 ) std::atomic< size_t > _tail = 0;
+	};
+
+	class uring_loop
+	{
+		enum op_t
+		{
+			Recv = 1,
+			Write = 2,
+			Wake = 3,
+		};
+
+		struct connection_t
+		{
+			int fd = -1;
+			size_t index = 0;
+			bool open = false;
+			bool recv_armed = false;
+
+			std::mutex mutex;
+			std::string pending;         // encoded by the client, not yet staged
+			bool dirty = false;
+
+			char * fixed = nullptr;      // registered buffer slot
+			size_t fixed_len = 0;
+			std::string overflow;        // bytes beyond the registered slot, sent by a linked SQE
+			size_t write_total = 0;
+			size_t write_done = 0;
+			int write_cqes = 0;          // completions still expected for the current write
+			bool write_failed = false;
+
+			std::unique_ptr< redis::client > client;
+		};
+
+	public:
+		using error_callback_t = std::function< void( redis::client &, const redis::value & ) >;
+
+	public:
+		uring_loop( uring_options options = {} )
+			: _options( options ), _tasks( options.task_queue )
+		{
+			io_uring_params params = {};
+			if ( _options.sqpoll )
+			{
+				params.flags |= IORING_SETUP_SQPOLL;
+				params.sq_thread_idle = _options.sqpoll_idle_ms;
+			}
+
+			_ring = int( ::syscall( __NR_io_uring_setup, _options.entries, &params ) );
+			if ( _ring < 0 )
+				throw std::system_error( errno, std::system_category(), "io_uring_setup" );
+
+			map_rings( params );
+			register_buffers();
+
+			_wake = ::eventfd( 0, EFD_CLOEXEC );
+			arm_wake();
+		}
+
+		~uring_loop()
+		{
+			if ( current() == this )
+				current() = nullptr;
+
+			for ( auto & it : _connections )
+			{
+				if ( it && it->open )
+					::close( it->fd );
+			}
+
+			if ( _wake >= 0 )
+				::close( _wake );
+			if ( _buf_ring != nullptr )
+				::munmap( _buf_ring, _buf_ring_size );
+			if ( _sqes != nullptr )
+				::munmap( _sqes, _sqes_size );
+			if ( _cq_ptr != nullptr && _cq_ptr != _sq_ptr )
+				::munmap( _cq_ptr, _cq_size );
+			if ( _sq_ptr != nullptr )
+				::munmap( _sq_ptr, _sq_size );
+			if ( _ring >= 0 )
+				::close( _ring );
+		}
+
+	public:
+		void on_error( error_callback_t callback )
+		{
+			_error = std::move( callback );
+		}
+
+		// Takes ownership of a connected stream socket. Call it before run() or from the loop thread;
+		// the returned client may be used from any thread.
+		redis::client & add( int fd )
+		{
+			// a closed slot is reused only once the kernel is done with it: a pending recv or write still
+			// references its buffers, and its completions carry nothing but the index
+			size_t index = 0;
+			while ( index < _connections.size() && _connections[index] && !drained( *_connections[index] ) )
+				++index;
+
+			if ( index >= _options.max_connections )
+				throw std::system_error( std::make_error_code( std::errc::too_many_files_open ), "uring_loop: max_connections" );
+
+			if ( index == _connections.size() )
+				_connections.emplace_back();
+
+			auto conn = std::make_unique< connection_t >();
+			conn->fd = fd;
+			conn->index = index;
+			conn->open = true;
+			conn->fixed = _fixed.data() + index * _options.write_buffer;
+
+			connection_t * ptr = conn.get();
+			conn->client = std::make_unique< redis::client >( [this, ptr]( std::string_view data ) { output( *ptr, data ); } );
+			conn->client->set_reader_thread( _loop_thread.load( std::memory_order_relaxed ) );
+
+			_connections[index] = std::move( conn );
+			arm_recv( *ptr );
+
+			return *ptr->client;
+		}
+
+		// Blocking TCP connect, then add()
+		redis::client & connect( const std::string & host, const std::string & port )
+		{
+			addrinfo hints = {}, * result = nullptr;
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+
+			if ( int err = ::getaddrinfo( host.c_str(), port.c_str(), &hints, &result ); err != 0 )
+				throw std::system_error( std::make_error_code( std::errc::host_unreachable ), ::gai_strerror( err ) );
+
+			int fd = -1;
+			for ( auto ai = result; ai != nullptr && fd < 0; ai = ai->ai_next )
+			{
+				fd = ::socket( ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol );
+				if ( fd >= 0 && ::connect( fd, ai->ai_addr, ai->ai_addrlen ) != 0 )
+				{
+					::close( fd );
+					fd = -1;
+				}
+			}
+			::freeaddrinfo( result );
+
+			if ( fd < 0 )
+				throw std::system_error( errno, std::system_category(), "connect" );
+
+			int on = 1;
+			::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+
+			return add( fd );
+		}
+
+		// Runs task on the loop thread; may be called from any thread. A loop thread never waits on a full
+		// queue, since the target may be waiting on its own: the task is kept and retried on its next run_once.
+		void post( std::function< void() > task )
+		{
+			uring_loop * caller = current();
+
+			if ( caller == nullptr )
+			{
+				_tasks.push( std::move( task ) );
+			}
+			else if ( !caller->_spill.empty() || !_tasks.try_push( std::move( task ) ) )
+			{
+				// behind earlier spilled tasks, so tasks from one loop keep their order
+				caller->_spill.emplace_back( this, std::move( task ) );
+				return;
+			}
+
+			wake();
+		}
+
+		// Runs posted tasks, stages pending writes, submits everything with one io_uring_enter and handles
+		// the completions. Waits for at least one completion when wait is set.
+		void run_once( bool wait = true )
+		{
+			// commands issued by tasks on this thread are admitted under overload_policy::Block, since only
+			// this thread can drain the replies they wait for
+			std::thread::id self = std::this_thread::get_id();
+			if ( _loop_thread.exchange( self, std::memory_order_relaxed ) != self )
+			{
+				for ( auto & it : _connections )
+				{
+					if ( it )
+						it->client->set_reader_thread( self );
+				}
+			}
+			current() = this;
+
+			std::function< void() > task;
+			while ( _tasks.pop( task ) )
+				task();
+
+			while ( !_spill.empty() && _spill.front().first->_tasks.try_push( std::move( _spill.front().second ) ) )
+			{
+				_spill.front().first->wake();
+				_spill.pop_front();
+			}
+
+			for ( auto & it : _connections )
+			{
+				if ( it && it->open )
+					flush( *it );
+			}
+
+			// spilled tasks are retried without sleeping
+			submit( wait && _spill.empty() ? 1 : 0 );
+			reap();
+		}
+
+		void run()
+		{
+			while ( !_stopped )
+				run_once();
+		}
+
+		// May be called from any thread
+		void stop()
+		{
+			_stopped = true;
+			wake();
+		}
+
+	private:
+		static uring_loop *& current()
+		{
+			static thread_local uring_loop * loop = nullptr;
+			return loop;
+		}
+
+		void map_rings( const io_uring_params & params )
+		{
+			_sq_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+			_cq_size = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+
+			bool single = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+			if ( single )
+				_sq_size = _cq_size = std::max( _sq_size, _cq_size );
+
+			_sq_ptr = ::mmap( nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQ_RING );
+			if ( _sq_ptr == MAP_FAILED )
+				throw std::system_error( errno, std::system_category(), "mmap sq" );
+
+			_cq_ptr = single ? _sq_ptr : ::mmap( nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_CQ_RING );
+			if ( _cq_ptr == MAP_FAILED )
+				throw std::system_error( errno, std::system_category(), "mmap cq" );
+
+			_sqes_size = params.sq_entries * sizeof( io_uring_sqe );
+			_sqes = static_cast< io_uring_sqe * >( ::mmap( nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQES ) );
+			if ( _sqes == MAP_FAILED )
+				throw std::system_error( errno, std::system_category(), "mmap sqes" );
+
+			char * sq = static_cast< char * >( _sq_ptr );
+			_sq_head = reinterpret_cast< unsigned * >( sq + params.sq_off.head );
+			_sq_tail = reinterpret_cast< unsigned * >( sq + params.sq_off.tail );
+			_sq_mask = *reinterpret_cast< unsigned * >( sq + params.sq_off.ring_mask );
+			_sq_entries = params.sq_entries;
+			_sq_flags = reinterpret_cast< unsigned * >( sq + params.sq_off.flags );
+			_sq_array = reinterpret_cast< unsigned * >( sq + params.sq_off.array );
+
+			char * cq = static_cast< char * >( _cq_ptr );
+			_cq_head = reinterpret_cast< unsigned * >( cq + params.cq_off.head );
+			_cq_tail = reinterpret_cast< unsigned * >( cq + params.cq_off.tail );
+			_cq_mask = *reinterpret_cast< unsigned * >( cq + params.cq_off.ring_mask );
+			_cqes = reinterpret_cast< io_uring_cqe * >( cq + params.cq_off.cqes );
+		}
+
+		void register_buffers()
+		{
+			// write side: one registered slot per connection
+			_fixed.resize( _options.max_connections * _options.write_buffer );
+
+			std::vector< iovec > iovs( _options.max_connections );
+			for ( size_t i = 0; i < iovs.size(); ++i )
+			{
+				iovs[i].iov_base = _fixed.data() + i * _options.write_buffer;
+				iovs[i].iov_len = _options.write_buffer;
+			}
+
+			if ( ::syscall( __NR_io_uring_register, _ring, IORING_REGISTER_BUFFERS, iovs.data(), unsigned( iovs.size() ) ) < 0 )
+				throw std::system_error( errno, std::system_category(), "IORING_REGISTER_BUFFERS" );
+
+			// read side: a provided buffer ring shared by every connection
+			_buf_ring_size = _options.read_buffers * sizeof( io_uring_buf );
+			_buf_ring = static_cast< io_uring_buf_ring * >( ::mmap( nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) );
+			if ( _buf_ring == MAP_FAILED )
+				throw std::system_error( errno, std::system_category(), "mmap buf ring" );
+
+			io_uring_buf_reg reg = {};
+			reg.ring_addr = reinterpret_cast< uint64_t >( _buf_ring );
+			reg.ring_entries = _options.read_buffers;
+			reg.bgid = 0;
+
+			if ( ::syscall( __NR_io_uring_register, _ring, IORING_REGISTER_PBUF_RING, &reg, 1 ) < 0 )
+				throw std::system_error( errno, std::system_category(), "IORING_REGISTER_PBUF_RING" );
+
+			_read.resize( size_t( _options.read_buffers ) * _options.read_buffer_size );
+			for ( unsigned i = 0; i < _options.read_buffers; ++i )
+				provide( uint16_t( i ) );
+		}
+
+		void provide( uint16_t bid )
+		{
+			unsigned mask = _options.read_buffers - 1;
+
+			// not _buf_ring->bufs: in C++ the uapi flexible array member does not start at offset 0
+			io_uring_buf & buf = reinterpret_cast< io_uring_buf * >( _buf_ring )[_buf_tail & mask];
+			buf.addr = reinterpret_cast< uint64_t >( _read.data() + size_t( bid ) * _options.read_buffer_size );
+			buf.len = unsigned( _options.read_buffer_size );
+			buf.bid = bid;
+
+			++_buf_tail;
+			__atomic_store_n( &_buf_ring->tail, _buf_tail, __ATOMIC_RELEASE );
+		}
+
+		io_uring_sqe * sqe()
+		{
+			unsigned head = __atomic_load_n( _sq_head, __ATOMIC_ACQUIRE );
+			if ( _sq_local_tail - head >= _sq_entries )
+			{
+				submit( 0 );
+				head = __atomic_load_n( _sq_head, __ATOMIC_ACQUIRE );
+				if ( _sq_local_tail - head >= _sq_entries )
+					return nullptr;
+			}
+
+			unsigned idx = _sq_local_tail & _sq_mask;
+			io_uring_sqe * e = &_sqes[idx];
+			std::memset( e, 0, sizeof( *e ) );
+			_sq_array[idx] = idx;
+			++_sq_local_tail;
+			++_to_submit;
+
+			return e;
+		}
+
+		void submit( unsigned wait )
+		{
+			__atomic_store_n( _sq_tail, _sq_local_tail, __ATOMIC_RELEASE );
+
+			unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+			unsigned count = _to_submit;
+
+			if ( _options.sqpoll )
+			{
+				// the kernel thread picks the entries up by itself unless it went idle
+				if ( __atomic_load_n( _sq_flags, __ATOMIC_ACQUIRE ) & IORING_SQ_NEED_WAKEUP )
+					flags |= IORING_ENTER_SQ_WAKEUP;
+				else if ( !wait )
+					count = 0;
+			}
+
+			if ( count == 0 && flags == 0 )
+			{
+				_to_submit = 0;
+				return;
+			}
+
+			// completions already waiting must not block the loop
+			if ( wait && __atomic_load_n( _cq_tail, __ATOMIC_ACQUIRE ) != *_cq_head )
+			{
+				wait = 0;
+				flags &= ~IORING_ENTER_GETEVENTS;
+			}
+
+			int ret = int( ::syscall( __NR_io_uring_enter, _ring, count, wait, flags, nullptr, 0 ) );
+			if ( ret >= 0 || errno != EINTR )
+				_to_submit = 0;
+		}
+
+		void reap()
+		{
+			unsigned head = *_cq_head;
+			unsigned tail = __atomic_load_n( _cq_tail, __ATOMIC_ACQUIRE );
+
+			for ( ; head != tail; ++head )
+			{
+				io_uring_cqe cqe = _cqes[head & _cq_mask];
+				__atomic_store_n( _cq_head, head + 1, __ATOMIC_RELEASE );
+
+				op_t op = op_t( cqe.user_data & 0xFF );
+				size_t index = size_t( cqe.user_data >> 8 );
+
+				if ( op == Wake )
+				{
+					arm_wake();
+					continue;
+				}
+
+				if ( index >= _connections.size() || !_connections[index] )
+					continue;
+
+				connection_t & conn = *_connections[index];
+
+				if ( op == Recv )
+					on_recv( conn, cqe );
+				else if ( op == Write )
+					on_write( conn, cqe );
+			}
+		}
+
+		void on_recv( connection_t & conn, const io_uring_cqe & cqe )
+		{
+			if ( !( cqe.flags & IORING_CQE_F_MORE ) )
+				conn.recv_armed = false;
+
+			if ( cqe.flags & IORING_CQE_F_BUFFER )
+			{
+				uint16_t bid = uint16_t( cqe.flags >> IORING_CQE_BUFFER_SHIFT );
+
+				if ( cqe.res > 0 && conn.open )
+				{
+					const char * data = _read.data() + size_t( bid ) * _options.read_buffer_size;
+					conn.client->input( data, data + cqe.res );
+				}
+
+				// the parser keeps its own copy, so the buffer goes straight back to the ring
+				provide( bid );
+			}
+
+			if ( !conn.open )
+				return;
+
+			if ( cqe.res == 0 )
+				return close( conn, redis::value( redis::value::io_error, "connection closed" ) );
+
+			if ( cqe.res == -EINVAL && _multishot )
+			{
+				// kernels before 6.0 have no multishot recv
+				_multishot = false;
+			}
+			else if ( cqe.res < 0 && cqe.res != -ENOBUFS )
+			{
+				return close( conn, redis::value( redis::value::io_error, std::system_category().message( -cqe.res ) ) );
+			}
+
+			if ( !conn.recv_armed )
+				arm_recv( conn );
+		}
+
+		void on_write( connection_t & conn, const io_uring_cqe & cqe )
+		{
+			--conn.write_cqes;
+
+			if ( cqe.res > 0 )
+				conn.write_done += size_t( cqe.res );
+			else if ( cqe.res != -ECANCELED )
+				conn.write_failed = true;
+
+			if ( conn.write_cqes != 0 || !conn.open )
+				return;
+
+			if ( conn.write_failed )
+				return close( conn, redis::value( redis::value::io_error, "write failed" ) );
+
+			// a short transfer breaks the link; put what was not sent back in front of the pending bytes
+			if ( conn.write_done < conn.write_total )
+			{
+				std::string rest;
+				if ( conn.write_done < conn.fixed_len )
+				{
+					rest.assign( conn.fixed + conn.write_done, conn.fixed_len - conn.write_done );
+					rest.append( conn.overflow );
+				}
+				else
+				{
+					rest = conn.overflow.substr( conn.write_done - conn.fixed_len );
+				}
+
+				std::unique_lock< std::mutex > lock( conn.mutex );
+				conn.pending.insert( 0, rest );
+				conn.dirty = true;
+			}
+
+			conn.fixed_len = conn.write_total = conn.write_done = 0;
+			conn.overflow.clear();
+		}
+
+		void arm_recv( connection_t & conn )
+		{
+			io_uring_sqe * e = sqe();
+			if ( e == nullptr )
+				return;
+
+			e->opcode = IORING_OP_RECV;
+			e->fd = conn.fd;
+			e->flags = IOSQE_BUFFER_SELECT;
+			e->buf_group = 0;
+			e->ioprio = _multishot ? IORING_RECV_MULTISHOT : 0;
+			e->user_data = ( uint64_t( conn.index ) << 8 ) | Recv;
+
+			conn.recv_armed = true;
+		}
+
+		void arm_wake()
+		{
+			io_uring_sqe * e = sqe();
+			if ( e == nullptr )
+				return;
+
+			e->opcode = IORING_OP_READ;
+			e->fd = _wake;
+			e->addr = reinterpret_cast< uint64_t >( &_wake_value );
+			e->len = sizeof( _wake_value );
+			e->user_data = Wake;
+		}
+
+		void wake()
+		{
+			if ( _loop_thread.load( std::memory_order_relaxed ) == std::this_thread::get_id() )
+				return;
+
+			uint64_t one = 1;
+			[[maybe_unused]] auto n = ::write( _wake, &one, sizeof( one ) );
+		}
+
+		// Called by the client under its write lock, from any thread
+		void output( connection_t & conn, std::string_view data )
+		{
+			bool notify;
+			{
+				std::unique_lock< std::mutex > lock( conn.mutex );
+				conn.pending.append( data.data(), data.size() );
+				notify = !conn.dirty;
+				conn.dirty = true;
+			}
+
+			if ( notify )
+				wake();
+		}
+
+		// Moves the pending bytes into the registered slot and queues them as one WRITE_FIXED, with a
+		// linked SEND for whatever does not fit so both go out in order in the same submission.
+		void flush( connection_t & conn )
+		{
+			if ( conn.write_cqes != 0 )
+				return;
+
+			std::string data;
+			{
+				std::unique_lock< std::mutex > lock( conn.mutex );
+				if ( !conn.dirty )
+					return;
+				data.swap( conn.pending );
+				conn.dirty = false;
+			}
+
+			if ( data.empty() )
+				return;
+
+			conn.fixed_len = std::min( data.size(), _options.write_buffer );
+			std::memcpy( conn.fixed, data.data(), conn.fixed_len );
+			conn.overflow.assign( data, conn.fixed_len, std::string::npos );
+			conn.write_total = data.size();
+			conn.write_done = 0;
+			conn.write_failed = false;
+
+			io_uring_sqe * e = sqe();
+			if ( e == nullptr )
+				return requeue( conn, data );
+
+			e->opcode = IORING_OP_WRITE_FIXED;
+			e->fd = conn.fd;
+			e->addr = reinterpret_cast< uint64_t >( conn.fixed );
+			e->len = unsigned( conn.fixed_len );
+			e->buf_index = uint16_t( conn.index );
+			e->user_data = ( uint64_t( conn.index ) << 8 ) | Write;
+			conn.write_cqes = 1;
+
+			if ( !conn.overflow.empty() )
+			{
+				e->flags |= IOSQE_IO_LINK;
+
+				io_uring_sqe * link = sqe();
+				if ( link == nullptr )
+				{
+					// the ring is full, send the rest with the next batch
+					e->flags &= ~IOSQE_IO_LINK;
+					conn.write_total = conn.fixed_len;
+					requeue( conn, conn.overflow );
+					conn.overflow.clear();
+					return;
+				}
+
+				link->opcode = IORING_OP_SEND;
+				link->fd = conn.fd;
+				link->addr = reinterpret_cast< uint64_t >( conn.overflow.data() );
+				link->len = unsigned( conn.overflow.size() );
+				link->msg_flags = MSG_NOSIGNAL;
+				link->user_data = ( uint64_t( conn.index ) << 8 ) | Write;
+				conn.write_cqes = 2;
+			}
+		}
+
+		void requeue( connection_t & conn, const std::string & data )
+		{
+			std::unique_lock< std::mutex > lock( conn.mutex );
+			conn.pending.insert( 0, data );
+			conn.dirty = true;
+		}
+
+		static bool drained( const connection_t & conn )
+		{
+			return !conn.open && conn.write_cqes == 0 && !conn.recv_armed;
+		}
+
+		void close( connection_t & conn, const redis::value & reason )
+		{
+			conn.open = false;
+			::shutdown( conn.fd, SHUT_RDWR );
+			::close( conn.fd );
+
+			conn.client->reset( [&conn]()
+			{
+				std::unique_lock< std::mutex > lock( conn.mutex );
+				conn.pending.clear();
+				conn.dirty = false;
+			} );
+
+			if ( _error )
+				_error( *conn.client, reason );
+		}
+
+	private:
+		uring_options _options;
+		error_callback_t _error;
+		std::atomic< bool > _stopped = false;
+		std::atomic< std::thread::id > _loop_thread;
+		bool _multishot = true;
+
+		int _ring = -1;
+		void * _sq_ptr = nullptr;
+		void * _cq_ptr = nullptr;
+		size_t _sq_size = 0;
+		size_t _cq_size = 0;
+		io_uring_sqe * _sqes = nullptr;
+		size_t _sqes_size = 0;
+
+		unsigned * _sq_head = nullptr;
+		unsigned * _sq_tail = nullptr;
+		unsigned * _sq_flags = nullptr;
+		unsigned * _sq_array = nullptr;
+		unsigned _sq_mask = 0;
+		unsigned _sq_entries = 0;
+		unsigned _sq_local_tail = 0;
+		unsigned _to_submit = 0;
+
+		unsigned * _cq_head = nullptr;
+		unsigned * _cq_tail = nullptr;
+		unsigned _cq_mask = 0;
+		io_uring_cqe * _cqes = nullptr;
+
+		io_uring_buf_ring * _buf_ring = nullptr;
+		size_t _buf_ring_size = 0;
+		uint16_t _buf_tail = 0;
+		std::vector< char > _read;
+		std::vector< char > _fixed;
+
+		int _wake = -1;
+		uint64_t _wake_value = 0;
+		mpsc_queue< std::function< void() > > _tasks;
+		std::deque< std::pair< uring_loop *, std::function< void() > > > _spill;  // posts from this loop to full queues
+
+		std::vector< std::unique_ptr< connection_t > > _connections;
+	};
+}
+
+#endif//REDIS_URING_HPP__E5B7D0A4_2C91_4F36_8D5B_61A9F3C7E204
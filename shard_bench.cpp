@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "redis_fake_server.hpp"
+#include "redis_shard.hpp"
+
+struct options_t
+{
+	std::string host = "127.0.0.1";
+	uint16_t port = 0;          // 0 starts the in-process fake server
+	size_t max_shards = std::max( 1u, std::thread::hardware_concurrency() );
+	size_t connections = 1;     // per shard
+	size_t depth = 64;          // commands in flight per shard
+	size_t keys = 10000;
+	double seconds = 2;
+	bool pin = true;
+};
+
+// Every shard drives its own closed loop: a completion on the shard issues the next command
+struct driver_t
+{
+	redis::shard_runtime * runtime = nullptr;
+	const options_t * opts = nullptr;
+	std::chrono::steady_clock::time_point deadline;
+	std::mt19937_64 rng;
+	std::atomic< size_t > done = 0;
+	std::atomic< size_t > inflight = 0;
+
+	void issue()
+	{
+		std::string key = "key:" + std::to_string( rng() % opts->keys );
+
+		++inflight;
+		runtime->get( key, [this]( redis::value )
+		{
+			++done;
+			--inflight;
+
+			if ( std::chrono::steady_clock::now() < deadline )
+				issue();
+		} );
+	}
+};
+
+static double run( const options_t & opts, uint16_t port, size_t shards )
+{
+	redis::shard_options so;
+	so.shards = shards;
+	so.connections_per_shard = opts.connections;
+	so.host = opts.host;
+	so.port = std::to_string( port );
+	so.pin_threads = opts.pin;
+
+	redis::shard_runtime runtime( so );
+
+	auto beg = std::chrono::steady_clock::now();
+	auto deadline = beg + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( opts.seconds ) );
+
+	std::vector< std::unique_ptr< driver_t > > drivers;
+	for ( size_t i = 0; i < shards; ++i )
+	{
+		auto driver = std::make_unique< driver_t >();
+		driver->runtime = &runtime;
+		driver->opts = &opts;
+		driver->deadline = deadline;
+		driver->rng.seed( 0x9E3779B97F4A7C15ull * ( i + 1 ) );
+
+		driver_t * ptr = driver.get();
+		runtime.post( i, [ptr]( redis::client & )
+		{
+			for ( size_t n = 0; n < ptr->opts->depth; ++n )
+				ptr->issue();
+		} );
+
+		drivers.push_back( std::move( driver ) );
+	}
+
+	std::this_thread::sleep_until( deadline );
+
+	for ( auto & it : drivers )
+	{
+		while ( it->inflight != 0 )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+
+	double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - beg ).count();
+
+	size_t total = 0;
+	for ( auto & it : drivers )
+		total += it->done;
+
+	return total / elapsed;
+}
+
+static void usage()
+{
+	std::printf( "redis_client_shard_bench [options]\n"
+				 "  --host <ip>          server address (127.0.0.1)\n"
+				 "  --port <port>        server port, 0 starts the in-process fake server (0)\n"
+				 "  --shards <n>         largest shard count, runs 1, 2, 4 .. n (hardware threads)\n"
+				 "  --connections <n>    connections per shard (1)\n"
+				 "  --depth <n>          commands in flight per shard (64)\n"
+				 "  --keys <n>           key space (10000)\n"
+				 "  --seconds <n>        duration of every step (2)\n"
+				 "  --no-pin             do not pin shard threads to cpus\n" );
+}
+
+int main( int argc, char ** argv )
+{
+	options_t opts;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		std::string_view arg = argv[i];
+		const char * next = i + 1 < argc ? argv[i + 1] : "";
+
+		if ( arg == "--no-pin" ) { opts.pin = false; continue; }
+		else if ( arg == "--host" ) opts.host = next;
+		else if ( arg == "--port" ) opts.port = uint16_t( std::atoi( next ) );
+		else if ( arg == "--shards" ) opts.max_shards = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--connections" ) opts.connections = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--depth" ) opts.depth = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--keys" ) opts.keys = std::max( 1, std::atoi( next ) );
+		else if ( arg == "--seconds" ) opts.seconds = std::atof( next );
+		else { usage(); return arg == "--help" ? 0 : 1; }
+		++i;
+	}
+
+	std::unique_ptr< redis::fake_server > server;
+	uint16_t port = opts.port;
+	if ( port == 0 )
+	{
+		server = std::make_unique< redis::fake_server >();
+		port = server->port();
+	}
+
+	std::printf( "%8s %14s %10s\n", "shards", "ops/s", "speedup" );
+
+	double base = 0;
+	for ( size_t shards = 1; ; shards = std::min( shards * 2, opts.max_shards ) )
+	{
+		double ops = run( opts, port, shards );
+		if ( base == 0 )
+			base = ops;
+
+		std::printf( "%8zu %14.0f %9.2fx\n", shards, ops, ops / base );
+
+		if ( shards == opts.max_shards )
+			break;
+	}
+
+	return 0;
+}